@@ -0,0 +1,163 @@
+#include "../shared_include/Protocol.hpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <stdexcept>
+#include <ctime>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Measures the CPU cost of sending one tick's room state to N recipients,
+// each on its own socketpair, three ways: every recipient gets its own
+// snapshot encoded and sent (what the server did with one encoder per
+// connection), the body is encoded once per baseline and goes through the
+// server's send queue behind each header, or the shared body is always
+// gathered by reference with the header into one sendmsg. Recipients
+// acknowledge with a lag of 1 to 3 snapshots, so a tick has three distinct
+// baselines. The receiving ends are drained outside the timed part.
+
+static const int TICKS = 300;
+static const int WARMUP_TICKS = 10;
+static const int PLAYERS = MAX_CLIENTS - 1;
+static const int RECIPIENTS[] = {10, 100, 1000};
+
+enum Mode { PER_CLIENT, SHARED_QUEUED, SHARED_GATHERED };
+static const char* const MODE_NAMES[] = {"per client", "shared queued", "shared gathered"};
+
+static void raiseFdLimit()
+{
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static int64_t cpuNs()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+struct Result {
+    double usPerTick;
+    double bytesPerRecipient;
+};
+
+static Result run(int recipients, Mode mode)
+{
+    std::vector<int> sending;
+    std::vector<int> receiving;
+    for (int i = 0; i < recipients; ++i) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+            for (size_t n = 0; n < sending.size(); ++n) {
+                close(sending[n]);
+                close(receiving[n]);
+            }
+            throw std::runtime_error("fd limit reached");
+        }
+        sending.push_back(pair[0]);
+        receiving.push_back(pair[1]);
+    }
+    Protocol::SnapshotEncoder encoder;
+    std::vector<Protocol::SendQueue> queues(recipients);
+    std::vector<uint8_t> header;
+    std::vector<uint8_t> body;
+    std::vector<uint8_t> frame;
+    std::vector<uint8_t> drain(1 << 16);
+    PacketModule room;
+    auto& pkt = room.getPacket();
+    pkt.nb_client = PLAYERS + 1;
+    // seqs of the last ticks, a recipient acknowledges one of them
+    uint16_t recent[4] = {};
+    Protocol::PlayerAck own;
+
+    int64_t totalNs = 0;
+    uint64_t bytes = 0;
+    for (int tick = 0; tick < WARMUP_TICKS + TICKS; ++tick) {
+        for (int i = 1; i <= PLAYERS; ++i) {
+            pkt.playerState[i] = PacketModule::PLAYING;
+            pkt.playerPosition[i] = std::make_pair(100 + tick * 3, 300 + (tick * i) % 50);
+            pkt.playerScore[i] = tick / (10 + i);
+        }
+        int64_t start = cpuNs();
+        encoder.record(pkt, tick);
+        for (int r = 0; r < recipients; ++r) {
+            uint16_t ack = recent[1 + r % 3];
+            own.inputSeq = tick;
+            ssize_t sent;
+            if (mode == PER_CLIENT) {
+                // the acknowledged snapshots are all recent, they are the baselines
+                encoder.encodeBody(ack, body);
+                encoder.encodeHeader(1 + r % PLAYERS, ack, body.size(), own, frame);
+                frame.insert(frame.end(), body.begin(), body.end());
+                sent = send(sending[r], frame.data(), frame.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            } else if (mode == SHARED_QUEUED) {
+                uint16_t baseline;
+                auto shared = encoder.body(ack, baseline);
+                encoder.encodeHeader(1 + r % PLAYERS, baseline, shared->size(), own, header);
+                queues[r].push(header);
+                queues[r].push(std::move(shared));
+                sent = queues[r].flush(sending[r]);
+            } else {
+                uint16_t baseline;
+                auto shared = encoder.body(ack, baseline);
+                encoder.encodeHeader(1 + r % PLAYERS, baseline, shared->size(), own, header);
+                iovec parts[2] = {{header.data(), header.size()},
+                    {const_cast<uint8_t*>(shared->data()), shared->size()}};
+                msghdr message{};
+                message.msg_iov = parts;
+                message.msg_iovlen = 2;
+                sent = sendmsg(sending[r], &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+            }
+            if (sent < 0) {
+                throw std::runtime_error("send failed");
+            }
+            if (tick >= WARMUP_TICKS) {
+                bytes += sent;
+            }
+        }
+        int64_t elapsed = cpuNs() - start;
+        if (tick >= WARMUP_TICKS) {
+            totalNs += elapsed;
+        }
+        for (int fd : receiving) {
+            while (recv(fd, drain.data(), drain.size(), MSG_DONTWAIT) > 0) {
+            }
+        }
+        recent[3] = recent[2];
+        recent[2] = recent[1];
+        recent[1] = encoder.getSeq();
+    }
+    for (int r = 0; r < recipients; ++r) {
+        close(sending[r]);
+        close(receiving[r]);
+    }
+    return {totalNs / 1000.0 / TICKS, bytes / double(TICKS) / recipients};
+}
+
+int main()
+{
+    raiseFdLimit();
+    std::cout << std::left << std::setw(12) << "recipients" << std::setw(18) << "mode" << std::setw(14) << "us/tick"
+              << std::setw(16) << "ns/recipient" << "bytes/recipient" << std::endl;
+    for (int recipients : RECIPIENTS) {
+        for (Mode mode : {PER_CLIENT, SHARED_QUEUED, SHARED_GATHERED}) {
+            try {
+                Result result = run(recipients, mode);
+                std::cout << std::left << std::setw(12) << recipients << std::setw(18) << MODE_NAMES[mode]
+                          << std::fixed << std::setprecision(1) << std::setw(14) << result.usPerTick
+                          << std::setw(16) << result.usPerTick * 1000 / recipients
+                          << result.bytesPerRecipient << std::endl;
+            } catch (const std::exception& e) {
+                std::cout << std::left << std::setw(12) << recipients << std::setw(18) << MODE_NAMES[mode]
+                          << e.what() << std::endl;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "../shared_include/SpatialGrid.hpp"
+#include "../shared_include/MapParser.hpp"
+#include "../shared_include/Simulation.hpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+
+// Runs the per-frame collision check of the client (player box against
+// every coin and zapper) over synthetic maps of 1k to 100k entities, once
+// with the linear scan the client used to do and once through SpatialGrid.
+
+static const int HEIGHT = 40;
+static const int QUERIES = 20000;
+
+using Clock = std::chrono::steady_clock;
+using Grid = SpatialGrid<int>;
+
+static std::vector<Grid::Box> entityBoxes(const GameMap& map)
+{
+    std::vector<Grid::Box> boxes;
+    for (int x = 0; x < map.width; ++x) {
+        for (int y = 0; y < map.height; ++y) {
+            TileType tile = map.getTile(x, y);
+            if (tile == TileType::COIN || tile == TileType::ELECTRIC) {
+                boxes.push_back({Simulation::tileX(x), Simulation::tileY(y), Simulation::TILE_SIZE, Simulation::TILE_SIZE});
+            }
+        }
+    }
+    return boxes;
+}
+
+// player boxes spread along the whole level, like a full run
+static std::vector<Grid::Box> playerBoxes(const GameMap& map)
+{
+    std::vector<Grid::Box> boxes;
+    float length = Simulation::tileX(map.width) - Simulation::START_X;
+    for (int i = 0; i < QUERIES; ++i) {
+        float x = Simulation::START_X + length * i / QUERIES;
+        float y = Simulation::tileY(i % map.height);
+        boxes.push_back({x, y, Simulation::PLAYER_SIZE, Simulation::PLAYER_SIZE});
+    }
+    return boxes;
+}
+
+template <typename Check>
+static double nsPerQuery(const std::vector<Grid::Box>& players, size_t& hits, Check check)
+{
+    hits = 0;
+    auto start = Clock::now();
+    for (const auto& player : players) {
+        hits += check(player);
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / players.size();
+}
+
+int main()
+{
+    std::cout << std::left << std::setw(12) << "entities" << std::setw(16) << "linear (ns)"
+              << std::setw(16) << "grid (ns)" << "hits" << std::endl;
+    for (int width : {800, 8000, 80000}) {
+        GameMap map = MapGenerator::generateTestMap(width, HEIGHT);
+        std::vector<Grid::Box> entities = entityBoxes(map);
+        std::vector<Grid::Box> players = playerBoxes(map);
+        Grid grid(Simulation::TILE_SIZE, Simulation::MAP_ORIGIN_X, Simulation::MAP_ORIGIN_Y);
+        for (size_t i = 0; i < entities.size(); ++i) {
+            grid.insert(entities[i], static_cast<int>(i));
+        }
+
+        size_t linearHits = 0;
+        double linearNs = nsPerQuery(players, linearHits, [&](const Grid::Box& player) {
+            size_t hits = 0;
+            for (const auto& entity : entities) {
+                hits += player.intersects(entity);
+            }
+            return hits;
+        });
+        size_t gridHits = 0;
+        double gridNs = nsPerQuery(players, gridHits, [&](const Grid::Box& player) {
+            size_t hits = 0;
+            grid.query(player, [&](const Grid::Box&, int) { hits++; });
+            return hits;
+        });
+
+        std::cout << std::left << std::setw(12) << entities.size() << std::fixed << std::setprecision(1)
+                  << std::setw(16) << linearNs << std::setw(16) << gridNs << gridHits << std::endl;
+        if (gridHits != linearHits) {
+            std::cerr << "grid found " << gridHits << " hits, linear scan " << linearHits << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "../shared_include/SharedGame.hpp"
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+
+// Hands PacketModule states from a writer thread (the network thread) to a
+// reader thread (the renderer) as fast as both can go, once through a
+// mutex-guarded copy like the client used to do and once through the
+// triple buffer. Every field of a state carries the same sequence number so
+// the reader also checks it never sees a torn state.
+
+static const auto DURATION = std::chrono::milliseconds(500);
+// the writer pauses between states to mimic the network loop, 0 = flat out
+static const int WRITER_PAUSES_US[] = {0, 100};
+// read latencies are bucketed by 50 ns up to 50 us
+static const int BUCKET_NS = 50;
+static const int BUCKETS = 1000;
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double writes;
+    double reads;
+    double readNs;
+    double p99ReadNs;
+    bool torn;
+};
+
+static void fill(PacketModule& state, int seq)
+{
+    auto& pkt = state.getPacket();
+    pkt.nb_client = seq;
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        pkt.playerScore[i] = seq;
+        pkt.playerPosition[i] = std::make_pair(seq, seq);
+    }
+}
+
+static bool consistent(PacketModule& state)
+{
+    auto& pkt = state.getPacket();
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (pkt.playerScore[i] != pkt.nb_client || pkt.playerPosition[i].second != pkt.nb_client) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Write, typename Read>
+static Result run(int pauseUs, Write write, Read read)
+{
+    std::atomic<bool> running(true);
+    long writes = 0;
+    std::thread writer([&] {
+        for (int seq = 1; running.load(std::memory_order_relaxed); ++seq) {
+            write(seq);
+            writes++;
+            if (pauseUs) {
+                std::this_thread::sleep_for(std::chrono::microseconds(pauseUs));
+            }
+        }
+    });
+    long reads = 0;
+    std::vector<long> histogram(BUCKETS + 1, 0);
+    bool torn = false;
+    auto start = Clock::now();
+    auto end = start + DURATION;
+    while (Clock::now() < end) {
+        auto before = Clock::now();
+        torn |= !read();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count();
+        histogram[std::min<long>(ns / BUCKET_NS, BUCKETS)]++;
+        reads++;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    running = false;
+    writer.join();
+    long below = 0;
+    int bucket = 0;
+    while (below < reads * 99 / 100 && bucket < BUCKETS) {
+        below += histogram[bucket++];
+    }
+    return {writes / seconds, reads / seconds, seconds * 1e9 / reads, static_cast<double>(bucket * BUCKET_NS), torn};
+}
+
+static void print(const char* name, int pauseUs, const Result& result)
+{
+    std::cout << std::left << std::setw(10) << name << std::setw(12) << pauseUs << std::fixed << std::setprecision(0)
+              << std::setw(16) << result.writes << std::setw(16) << result.reads << std::setprecision(1)
+              << std::setw(14) << result.readNs << std::setw(16) << result.p99ReadNs
+              << (result.torn ? "TORN" : "ok") << std::endl;
+}
+
+int main()
+{
+    std::cout << std::left << std::setw(10) << "handoff" << std::setw(12) << "pause (us)" << std::setw(16) << "writes/s"
+              << std::setw(16) << "reads/s" << std::setw(14) << "read (ns)" << std::setw(16) << "p99 read (ns)"
+              << "check" << std::endl;
+    bool torn = false;
+    for (int pauseUs : WRITER_PAUSES_US) {
+        std::mutex mutex;
+        PacketModule shared;
+        PacketModule copy;
+        Result locked = run(pauseUs, [&](int seq) {
+            PacketModule incoming;
+            fill(incoming, seq);
+            std::lock_guard<std::mutex> lock(mutex);
+            shared = incoming;
+        }, [&] {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                copy = shared;
+            }
+            return consistent(copy);
+        });
+        print("mutex", pauseUs, locked);
+
+        ClientModule::TripleBuffer<PacketModule> buffer;
+        Result tripled = run(pauseUs, [&](int seq) {
+            fill(buffer.writeBuffer(), seq);
+            buffer.publish();
+        }, [&] {
+            buffer.update();
+            return consistent(buffer.read());
+        });
+        print("triple", pauseUs, tripled);
+        torn |= locked.torn || tripled.torn;
+    }
+    return torn ? 1 : 0;
+}
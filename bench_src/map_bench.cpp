@@ -0,0 +1,99 @@
+#include "../shared_include/MapFormat.hpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Loads the same 1M-column map from the ASCII format (GameMap parser) and
+// from the binary format (mmap + PackedMap), then reads every tile once.
+
+static const int WIDTH = 1000000;
+static const int HEIGHT = 10;
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+template <typename Map>
+static size_t countCoins(const Map& map)
+{
+    size_t coins = 0;
+    for (int x = 0; x < map.width; ++x) {
+        for (int y = 0; y < map.height; ++y) {
+            coins += map.getTile(x, y) == TileType::COIN;
+        }
+    }
+    return coins;
+}
+
+static void printRow(const char* format, double loadMs, double scanMs, size_t bytes, size_t coins)
+{
+    std::cout << std::left << std::setw(10) << format << std::setw(14) << std::fixed << std::setprecision(2)
+              << loadMs << std::setw(14) << scanMs << std::setw(16) << bytes << coins << std::endl;
+}
+
+int main()
+{
+    char textPath[] = "/tmp/jetpack_map_XXXXXX";
+    char binaryPath[] = "/tmp/jetpack_jpm_XXXXXX";
+    int textFd = mkstemp(textPath);
+    int binaryFd = mkstemp(binaryPath);
+    if (textFd < 0 || binaryFd < 0) {
+        std::cerr << "Cannot create temporary files" << std::endl;
+        return 1;
+    }
+    close(textFd);
+    close(binaryFd);
+    GameMap generated = MapGenerator::generateTestMap(WIDTH, HEIGHT);
+    MapGenerator::saveMapToFile(generated, textPath);
+    std::vector<uint8_t> packed = MapFormat::pack(generated);
+    std::ofstream(binaryPath, std::ios::binary).write(reinterpret_cast<const char*>(packed.data()), packed.size());
+
+    std::cout << WIDTH << "x" << HEIGHT << " map" << std::endl;
+    std::cout << std::left << std::setw(10) << "format" << std::setw(14) << "load (ms)" << std::setw(14)
+              << "scan (ms)" << std::setw(16) << "resident bytes" << "coins" << std::endl;
+
+    auto start = Clock::now();
+    GameMap text = GameMap::loadFromFile(textPath);
+    double loadMs = msSince(start);
+    start = Clock::now();
+    size_t coins = countCoins(text);
+    double scanMs = msSince(start);
+    size_t textBytes = sizeof(text) + text.cells.capacity();
+    printRow("text", loadMs, scanMs, textBytes, coins);
+
+    start = Clock::now();
+    int fd = open(binaryPath, O_RDONLY);
+    struct stat info;
+    fstat(fd, &info);
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    MapFormat::PackedMap binary;
+    if (data == MAP_FAILED || !binary.open(static_cast<const uint8_t*>(data), info.st_size)) {
+        std::cerr << "Cannot open the binary map" << std::endl;
+        return 1;
+    }
+    loadMs = msSince(start);
+    start = Clock::now();
+    size_t binaryCoins = countCoins(binary);
+    scanMs = msSince(start);
+    printRow("binary", loadMs, scanMs, info.st_size, binaryCoins);
+
+    munmap(data, info.st_size);
+    std::remove(textPath);
+    std::remove(binaryPath);
+    if (binaryCoins != coins) {
+        std::cerr << "binary map does not match the text map" << std::endl;
+        return 1;
+    }
+    return 0;
+}
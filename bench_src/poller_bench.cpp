@@ -0,0 +1,89 @@
+#include "../shared_include/Poller.hpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+// Measures the cost of one wakeup of the server event loop while N idle
+// connections are registered. Idle connections are eventfds (one fd each, so
+// 10k of them fit in the default fd limit); the active connection is a
+// socketpair that gets one byte written before every wait.
+
+static const int WAKEUPS = 2000;
+
+static void raiseFdLimit()
+{
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static double benchWakeup(const std::string& backend, int idle)
+{
+    auto poller = Poller::create(backend);
+    std::vector<int> idleFds;
+    for (int i = 0; i < idle; ++i) {
+        int fd = eventfd(0, EFD_NONBLOCK);
+        if (fd < 0) {
+            for (int open_fd : idleFds) {
+                close(open_fd);
+            }
+            throw std::runtime_error("fd limit reached");
+        }
+        idleFds.push_back(fd);
+        poller->add(fd);
+    }
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+        throw std::runtime_error("socketpair failed");
+    }
+    fcntl(pair[0], F_SETFL, fcntl(pair[0], F_GETFL, 0) | O_NONBLOCK);
+    poller->add(pair[0]);
+
+    std::vector<int> ready;
+    char byte = 0;
+    std::chrono::nanoseconds total{0};
+    for (int i = 0; i < WAKEUPS; ++i) {
+        if (write(pair[1], &byte, 1) != 1) {
+            throw std::runtime_error("write failed");
+        }
+        auto start = std::chrono::steady_clock::now();
+        poller->wait(ready, 1000);
+        total += std::chrono::steady_clock::now() - start;
+        while (read(pair[0], &byte, 1) > 0) {}
+    }
+    close(pair[0]);
+    close(pair[1]);
+    for (int fd : idleFds) {
+        close(fd);
+    }
+    return std::chrono::duration<double, std::micro>(total).count() / WAKEUPS;
+}
+
+int main()
+{
+    raiseFdLimit();
+    std::cout << std::left << std::setw(10) << "idle" << std::setw(16) << "poll (us)"
+              << std::setw(16) << "epoll (us)" << std::endl;
+    for (int idle : {10, 1000, 10000}) {
+        std::cout << std::setw(10) << idle;
+        for (const char *backend : {"poll", "epoll"}) {
+            try {
+                std::cout << std::setw(16) << std::fixed << std::setprecision(2)
+                          << benchWakeup(backend, idle);
+            } catch (const std::exception& e) {
+                std::cout << std::setw(16) << "skipped";
+            }
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "../shared_include/Prediction.hpp"
+#include "../shared_include/Protocol.hpp"
+#include <iostream>
+#include <iomanip>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// Runs a client and a room simulation against each other in simulated time,
+// with the inputs and snapshots going through the real encoders and a delay
+// line of the given round trip (plus jitter) in each direction. Reports how
+// far each snapshot moves the locally predicted player, once reconciling by
+// replaying the unacknowledged inputs and once just snapping to the server
+// state like a client without input sequence numbers would. With spikes
+// on, an uplink segment is retransmitted every couple of seconds, holding
+// back the inputs behind it and starving the server for a while.
+
+static const int STEP_RATE = 60;
+static const int SEND_EVERY = 2;
+static const int64_t STEP_US = 1000000 / STEP_RATE;
+static const int64_t FRAME_US = 16667;
+static const int64_t FRAME_JITTER_US = 2000;
+static const int64_t DURATION_US = 20000000;
+// the first second only shows the server waiting for the first inputs
+static const int64_t WARMUP_US = 1000000;
+static const int RTTS_MS[] = {0, 50, 100, 200};
+static const int64_t SPIKE_EVERY_US = 2000000;
+static const int64_t SPIKE_US = 200000;
+
+// deterministic, every run sees the same latencies and inputs
+class Random {
+    public:
+        explicit Random(uint32_t seed) : _state(seed) {}
+        int64_t below(int64_t max) {
+            _state = _state * 1664525u + 1013904223u;
+            return max > 0 ? (_state >> 8) % max : 0;
+        }
+    private:
+        uint32_t _state;
+};
+
+template <typename T>
+struct DelayLine {
+    std::deque<std::pair<int64_t, T>> queue;
+    // one-way delay with up to 10% jitter, TCP keeps the order
+    void send(int64_t now, int64_t delayUs, Random& random, T value, int64_t extraUs = 0) {
+        int64_t at = now + delayUs + random.below(delayUs / 10 + 1) + extraUs;
+        if (!queue.empty()) {
+            at = std::max(at, queue.back().first);
+        }
+        queue.emplace_back(at, std::move(value));
+    }
+    bool receive(int64_t now, T& value) {
+        if (queue.empty() || queue.front().first > now) {
+            return false;
+        }
+        value = std::move(queue.front().second);
+        queue.pop_front();
+        return true;
+    }
+};
+
+struct Result {
+    int snapshots = 0;
+    int corrected = 0;
+    double totalPx = 0;
+    double maxPx = 0;
+    int starvedSteps = 0;
+};
+
+static Result run(int rttMs, bool spikes, bool replay)
+{
+    Random random(42);
+    Random inputs(7);
+    int64_t oneWayUs = rttMs * 500;
+    DelayLine<std::vector<uint8_t>> uplink;
+    DelayLine<std::vector<uint8_t>> downlink;
+
+    // server side, what Room does for one player
+    Prediction::InputQueue queue;
+    Simulation::PlayerState server;
+    Protocol::SnapshotEncoder encoder;
+    uint16_t snapshotAck = 0;
+    PacketModule room;
+    room.getPacket().nb_client = 2;
+    room.getPacket().client_id = 1;
+    room.getPacket().playerState[1] = PacketModule::PLAYING;
+    int steps = 0;
+    int64_t nextStep = STEP_US;
+
+    // client side, what the game and network threads do
+    Prediction::Predictor predictor(STEP_RATE);
+    Protocol::SnapshotDecoder decoder;
+    PacketModule decoded;
+    uint16_t sentSeq = 0;
+    bool jetpack = false;
+    int64_t nextToggle = 0;
+    int64_t lastFrame = 0;
+    int64_t nextFrame = FRAME_US;
+    int64_t nextSpike = SPIKE_EVERY_US;
+
+    Result result;
+    std::vector<uint8_t> message;
+    for (int64_t now = 0; now < DURATION_US; now += 100) {
+        while (uplink.receive(now, message)) {
+            Protocol::Input input;
+            if (Protocol::decodeInput(message.data(), message.size(), input)) {
+                queue.push(input);
+                if (input.ack != 0) {
+                    snapshotAck = input.ack;
+                }
+            }
+        }
+        if (now >= nextStep) {
+            if (queue.size() == 0 && now >= WARMUP_US) {
+                result.starvedSteps++;
+            }
+            Simulation::stepPlayer(server, queue.next(), 1.0f / STEP_RATE);
+            nextStep += STEP_US;
+            if (++steps % SEND_EVERY == 0) {
+                room.getPacket().playerPosition[1] = std::make_pair(static_cast<int>(server.x), static_cast<int>(server.y));
+                Protocol::PlayerAck own;
+                own.inputSeq = queue.getLastSeq();
+                own.state = server;
+                std::vector<uint8_t> snapshot;
+                encoder.record(room.getPacket(), steps);
+                encoder.encodeFrame(1, snapshotAck, own, snapshot);
+                snapshot.erase(snapshot.begin(), snapshot.begin() + Protocol::FRAME_HEADER_SIZE);
+                downlink.send(now, oneWayUs, random, snapshot);
+            }
+        }
+        if (now < nextFrame) {
+            continue;
+        }
+        // one client frame: newest snapshot, reconcile, predict, send
+        bool fresh = false;
+        while (downlink.receive(now, message)) {
+            fresh |= decoder.decode(message.data(), message.size(), decoded.getPacket());
+        }
+        if (fresh) {
+            const Protocol::PlayerAck& ack = decoder.getAck();
+            float moved = predictor.reconcile(replay ? ack.inputSeq : predictor.getSeq(), ack.state);
+            if (now >= WARMUP_US) {
+                result.snapshots++;
+                result.corrected += moved > 0.01f;
+                result.totalPx += moved;
+                result.maxPx = std::max<double>(result.maxPx, moved);
+            }
+        }
+        if (now >= nextToggle) {
+            jetpack = !jetpack;
+            nextToggle = now + 100000 + inputs.below(500000);
+        }
+        predictor.advance((now - lastFrame) / 1e6f, jetpack);
+        lastFrame = now;
+        nextFrame = now + FRAME_US - FRAME_JITTER_US + random.below(2 * FRAME_JITTER_US);
+
+        uint16_t unsent = predictor.getSeq() - sentSeq;
+        Protocol::Input input;
+        input.ack = decoder.getLastSeq();
+        input.jetpack = jetpack;
+        if (unsent > 0) {
+            input.seq = predictor.getSeq();
+            input.count = std::min<int>(unsent, Protocol::MAX_INPUT_HISTORY);
+            input.history = predictor.getJetpackHistory();
+            sentSeq = predictor.getSeq();
+        }
+        Protocol::encodeInput(input, message);
+        int64_t extraUs = 0;
+        if (spikes && now >= nextSpike) {
+            extraUs = SPIKE_US;
+            nextSpike += SPIKE_EVERY_US;
+        }
+        uplink.send(now, oneWayUs, random, message, extraUs);
+    }
+    return result;
+}
+
+int main()
+{
+    std::cout << std::left << std::setw(10) << "rtt (ms)" << std::setw(8) << "spikes" << std::setw(10) << "mode" << std::setw(12) << "snapshots"
+              << std::setw(12) << "corrected" << std::setw(12) << "avg (px)" << std::setw(12) << "max (px)"
+              << "starved steps" << std::endl;
+    for (int rtt : RTTS_MS) {
+        for (bool spikes : {false, true}) {
+            for (bool replay : {true, false}) {
+                Result result = run(rtt, spikes, replay);
+                std::cout << std::left << std::setw(10) << rtt << std::setw(8) << (spikes ? "yes" : "no")
+                          << std::setw(10) << (replay ? "replay" : "snap") << std::setw(12) << result.snapshots
+                          << std::setw(12) << result.corrected << std::fixed << std::setprecision(2) << std::setw(12)
+                          << (result.snapshots ? result.totalPx / result.snapshots : 0.0)
+                          << std::setw(12) << result.maxPx << result.starvedSteps << std::endl;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "../shared_include/MapScan.hpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+// Times MapScan::findTiles at every level this CPU supports against the
+// getTile loop it replaces, on a synthetic 100000x40 map.
+
+static const int WIDTH = 100000;
+static const int HEIGHT = 40;
+static const int RANGE = 64;
+
+using Clock = std::chrono::steady_clock;
+
+static double nsPer(int count, const std::function<size_t()>& run, size_t& result)
+{
+    auto start = Clock::now();
+    result = run();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+}
+
+// column ranges as streamed by chunks
+static size_t findLoop(const GameMap& map, bool simd)
+{
+    std::vector<MapScan::Cell> cells;
+    size_t found = 0;
+    for (int first = 0; first < map.width; first += RANGE) {
+        cells.clear();
+        if (simd) {
+            MapScan::findTiles(map, TileType::COIN, TileType::ELECTRIC, first, first + RANGE, cells);
+        } else {
+            for (int y = 0; y < map.height; ++y) {
+                for (int x = first; x < std::min(first + RANGE, map.width); ++x) {
+                    TileType tile = map.getTile(x, y);
+                    if (tile == TileType::COIN || tile == TileType::ELECTRIC) {
+                        cells.push_back({x, y, tile});
+                    }
+                }
+            }
+        }
+        found += cells.size();
+    }
+    return found;
+}
+
+int main()
+{
+    GameMap map = MapGenerator::generateTestMap(WIDTH, HEIGHT);
+    int ranges = (WIDTH + RANGE - 1) / RANGE;
+    std::cout << WIDTH << "x" << HEIGHT << " map, best level " << MapScan::name(MapScan::detect()) << std::endl;
+    std::cout << std::left << std::setw(10) << "kernel" << "find (ns/range)" << std::endl;
+
+    size_t expectedFind = 0;
+    double findNs = nsPer(ranges, [&] { return findLoop(map, false); }, expectedFind);
+    std::cout << std::left << std::setw(10) << "getTile" << std::fixed << std::setprecision(1) << findNs << std::endl;
+
+    for (MapScan::Level level : {MapScan::Level::SCALAR, MapScan::Level::SSE2, MapScan::Level::AVX2}) {
+        if (level > MapScan::detect()) {
+            continue;
+        }
+        MapScan::setLevel(level);
+        size_t found = 0;
+        findNs = nsPer(ranges, [&] { return findLoop(map, true); }, found);
+        std::cout << std::left << std::setw(10) << MapScan::name(level) << findNs << std::endl;
+        if (found != expectedFind) {
+            std::cerr << MapScan::name(level) << " results differ from the getTile loop" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
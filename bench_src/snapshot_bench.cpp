@@ -0,0 +1,90 @@
+#include "../shared_include/Protocol.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+
+// Encodes a moving room state into snapshots, decodes them back and checks
+// the round trip, for a few room sizes and with / without acknowledgements.
+
+static const int ITERATIONS = 100000;
+
+static bool samePacket(const PacketModule::Packet& a, const PacketModule::Packet& b)
+{
+    if (a.nb_client != b.nb_client || a.client_id != b.client_id) {
+        return false;
+    }
+    for (int i = 0; i < a.nb_client; ++i) {
+        if (a.playerState[i] != b.playerState[i] || a.playerPosition[i] != b.playerPosition[i]
+            || a.playerScore[i] != b.playerScore[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void benchRoundTrip(int players, bool acked)
+{
+    Protocol::SnapshotEncoder encoder;
+    Protocol::SnapshotDecoder decoder;
+    PacketModule source;
+    PacketModule decoded;
+    Protocol::PlayerAck own;
+    auto& pkt = source.getPacket();
+    pkt.nb_client = players + 1;
+    pkt.client_id = 1;
+    std::vector<uint8_t> buffer;
+    uint16_t ack = 0;
+    std::chrono::nanoseconds encodeTime{0};
+    std::chrono::nanoseconds decodeTime{0};
+    size_t bytes = 0;
+
+    for (int n = 0; n < ITERATIONS; ++n) {
+        // everybody scrolls, every other player moves vertically, coins now and then
+        for (int i = 1; i <= players; ++i) {
+            pkt.playerState[i] = PacketModule::PLAYING;
+            pkt.playerPosition[i] = std::make_pair(100 + n * 3, 300 + ((n * i) % 7 == 0 ? i : 0));
+            pkt.playerScore[i] = n / (50 + i);
+        }
+        auto start = std::chrono::steady_clock::now();
+        own.inputSeq = n;
+        own.state.x = pkt.playerPosition[1].first;
+        own.state.y = pkt.playerPosition[1].second;
+        encoder.record(pkt, n);
+        encoder.encodeFrame(pkt.client_id, ack, own, buffer);
+        auto encoded = std::chrono::steady_clock::now();
+        if (!decoder.decode(buffer.data() + Protocol::FRAME_HEADER_SIZE, buffer.size() - Protocol::FRAME_HEADER_SIZE,
+                decoded.getPacket())) {
+            std::cerr << "decode failed at snapshot " << n << std::endl;
+            std::exit(1);
+        }
+        auto end = std::chrono::steady_clock::now();
+        encodeTime += encoded - start;
+        decodeTime += end - encoded;
+        bytes += buffer.size();
+        if (!samePacket(pkt, decoded.getPacket())) {
+            std::cerr << "round trip mismatch at snapshot " << n << std::endl;
+            std::exit(1);
+        }
+        if (acked) {
+            ack = decoder.getLastSeq();
+        }
+    }
+    std::cout << std::left << std::setw(10) << players << std::setw(8) << (acked ? "yes" : "no")
+              << std::setw(14) << std::fixed << std::setprecision(1) << encodeTime.count() / double(ITERATIONS)
+              << std::setw(14) << decodeTime.count() / double(ITERATIONS)
+              << std::setw(14) << bytes / double(ITERATIONS)
+              << sizeof(PacketModule::Packet) << std::endl;
+}
+
+int main()
+{
+    std::cout << std::left << std::setw(10) << "players" << std::setw(8) << "acked"
+              << std::setw(14) << "encode (ns)" << std::setw(14) << "decode (ns)"
+              << std::setw(14) << "bytes/snap" << "raw bytes" << std::endl;
+    for (int players : {2, 4, MAX_CLIENTS - 1}) {
+        benchRoundTrip(players, false);
+        benchRoundTrip(players, true);
+    }
+    return 0;
+}
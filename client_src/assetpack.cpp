@@ -0,0 +1,150 @@
+#include "../shared_include/AssetPack.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static void writeLE(uint8_t* out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+}
+
+static uint64_t readLE(const uint8_t* data, size_t bytes)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(data[i]) << (i * 8);
+    }
+    return value;
+}
+
+static size_t alignUp(size_t value, size_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+AssetPack::Archive::~Archive()
+{
+    close();
+}
+
+void AssetPack::Archive::close()
+{
+    if (_mapping) {
+        munmap(_mapping, _mappingSize);
+    }
+    _mapping = nullptr;
+    _mappingSize = 0;
+    _entries.clear();
+}
+
+bool AssetPack::Archive::open(const std::string& path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < HEADER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    _mapping = data;
+    _mappingSize = info.st_size;
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    size_t count = readLE(bytes + 6, 2);
+    if (std::memcmp(bytes, MAGIC, sizeof(MAGIC)) != 0 || readLE(bytes + 4, 2) != VERSION
+        || _mappingSize < HEADER_SIZE + count * ENTRY_SIZE) {
+        close();
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* raw = bytes + HEADER_SIZE + i * ENTRY_SIZE;
+        uint64_t offset = readLE(raw + 48, 8);
+        uint64_t size = readLE(raw + 56, 8);
+        if (raw[NAME_SIZE - 1] != 0 || raw[32] > static_cast<uint8_t>(Kind::FONT)
+            || raw[33] > static_cast<uint8_t>(Encoding::PCM) || offset % BLOB_ALIGN != 0
+            || offset > _mappingSize || size > _mappingSize - offset) {
+            close();
+            return false;
+        }
+        Entry entry;
+        entry.name = reinterpret_cast<const char*>(raw);
+        entry.kind = static_cast<Kind>(raw[32]);
+        entry.encoding = static_cast<Encoding>(raw[33]);
+        entry.channels = readLE(raw + 34, 2);
+        entry.width = readLE(raw + 36, 4);
+        entry.height = readLE(raw + 40, 4);
+        entry.sampleRate = readLE(raw + 44, 4);
+        entry.data = bytes + offset;
+        entry.size = size;
+        if (entry.encoding == Encoding::RGBA && static_cast<uint64_t>(entry.width) * entry.height * 4 != size) {
+            close();
+            return false;
+        }
+        _entries.push_back(entry);
+    }
+    return true;
+}
+
+const AssetPack::Entry* AssetPack::Archive::find(const std::string& name, Kind kind) const
+{
+    for (const auto& entry : _entries) {
+        if (entry.kind == kind && entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void AssetPack::Archive::prefetch(const Entry& entry) const
+{
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t offset = entry.data - static_cast<const uint8_t*>(_mapping);
+    size_t start = offset / page * page;
+    madvise(static_cast<uint8_t*>(_mapping) + start, offset + entry.size - start, MADV_WILLNEED);
+}
+
+std::vector<uint8_t> AssetPack::build(const std::vector<Entry>& entries, const std::vector<std::vector<uint8_t>>& blobs)
+{
+    if (entries.size() != blobs.size() || entries.size() > UINT16_MAX) {
+        throw std::runtime_error("Invalid asset list");
+    }
+    size_t offset = alignUp(HEADER_SIZE + entries.size() * ENTRY_SIZE, BLOB_ALIGN);
+    std::vector<uint8_t> out(offset, 0);
+    std::memcpy(out.data(), MAGIC, sizeof(MAGIC));
+    writeLE(out.data() + 4, VERSION, 2);
+    writeLE(out.data() + 6, entries.size(), 2);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry& entry = entries[i];
+        if (entry.name.empty() || entry.name.size() >= NAME_SIZE) {
+            throw std::runtime_error("Invalid asset name: " + entry.name);
+        }
+        uint8_t* raw = out.data() + HEADER_SIZE + i * ENTRY_SIZE;
+        std::memcpy(raw, entry.name.data(), entry.name.size());
+        raw[32] = static_cast<uint8_t>(entry.kind);
+        raw[33] = static_cast<uint8_t>(entry.encoding);
+        writeLE(raw + 34, entry.channels, 2);
+        writeLE(raw + 36, entry.width, 4);
+        writeLE(raw + 40, entry.height, 4);
+        writeLE(raw + 44, entry.sampleRate, 4);
+        writeLE(raw + 48, offset, 8);
+        writeLE(raw + 56, blobs[i].size(), 8);
+        offset = alignUp(offset + blobs[i].size(), BLOB_ALIGN);
+    }
+    for (const auto& blob : blobs) {
+        out.insert(out.end(), blob.begin(), blob.end());
+        out.resize(alignUp(out.size(), BLOB_ALIGN), 0);
+    }
+    return out;
+}
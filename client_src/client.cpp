@@ -11,12 +11,30 @@
 #include <csignal>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/eventfd.h>
+#include "../shared_include/Poller.hpp"
+#include <cstring>
+#include <iterator>
+#include <algorithm>
 
 std::atomic<bool> g_shutdown{false};
+// lets the signal handler wake the network thread out of poll
+std::atomic<int> g_wakeFd{-1};
+
+// the network thread sleeps until the server or the game thread has something
+static const auto SEND_INTERVAL = std::chrono::milliseconds(10);
+
+static void wake(int wakeFd) {
+    uint64_t one = 1;
+    if (wakeFd >= 0 && write(wakeFd, &one, sizeof(one)) < 0) {
+        // the counter is saturated, the thread is awake anyway
+    }
+}
 
 void signalHandler(int signal) {
     std::cout << "Received signal " << signal << ", shutting down..." << std::endl;
     g_shutdown = true;
+    wake(g_wakeFd);
 }
 
 void ClientModule::Client::parseArguments(int argc, const char *argv[]) {
@@ -28,15 +46,18 @@ void ClientModule::Client::parseArguments(int argc, const char *argv[]) {
             serverPort = std::stoi(argv[++i]);
         } else if (arg == "-d") {
             debugMode = true;
+        } else if (arg == "-r") {
+            rawMode = true;
         }
     }
     if (serverIp.empty() || serverPort <= 0) {
-        throw std::runtime_error("Missing required arguments. Usage: ./jetpack_client -h <ip> -p <port> [-d]");
+        throw std::runtime_error("Missing required arguments. Usage: ./jetpack_client -h <ip> -p <port> [-d] [-r]");
     }
 }
 
 ClientModule::Client::Client(int ac, const char *av[]) :
-    fd(-1), id(-1), serverPort(-1), serverIp(""), connected(false), debugMode(false)
+    sentInputSeq(0), copiedBytes(0), fd(-1), wakeFd(-1), id(-1), serverPort(-1), serverIp(""), connected(false), debugMode(false),
+    rawMode(false)
 {
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
@@ -45,6 +66,7 @@ ClientModule::Client::Client(int ac, const char *av[]) :
         std::cout << "[CLIENT] Debug mode enabled" << std::endl;
         std::cout << "[CLIENT] Server IP: " << serverIp << std::endl;
         std::cout << "[CLIENT] Server Port: " << serverPort << std::endl;
+        std::cout << "[CLIENT] Protocol: " << (rawMode ? "raw packets" : "snapshots") << std::endl;
     }
 }
 
@@ -53,6 +75,10 @@ ClientModule::Client::~Client() {
         close(fd);
     }
     stop();
+    if (wakeFd >= 0) {
+        g_wakeFd = -1;
+        close(wakeFd);
+    }
     if (debugMode) {
         std::cout << "[CLIENT] Destroyed client" << std::endl;
     }
@@ -79,6 +105,11 @@ void ClientModule::Client::run() {
     if (debugMode) {
         std::cout << "[CLIENT] Connected to server at " << getAddress() << std::endl;
     }
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        throw std::runtime_error("Failed to create eventfd");
+    }
+    g_wakeFd = wakeFd;
     startThread();
     runThread();
 }
@@ -86,6 +117,7 @@ void ClientModule::Client::run() {
 void ClientModule::Client::stop() {
     if (connected) {
         connected = false;
+        wakeNetworkThread();
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
         close(fd);
         fd = -1;
@@ -101,6 +133,182 @@ std::string ClientModule::Client::getAddress() const {
     return std::string(ip) + ":" + std::to_string(ntohs(address.sin_port));
 }
 
+int ClientModule::Client::receiveRawPacket(PacketModule& incomingPacket) {
+    // the map frames come first, raw packets only follow them
+    if (!mapReceiver.isComplete()) {
+        int result = receiveFrames(incomingPacket);
+        if (result != 0 || !mapReceiver.isComplete()) {
+            return result;
+        }
+    }
+    // only the newest packet matters
+    int received = 0;
+    while (stream.nextBytes(&incomingPacket.getPacket(), sizeof(PacketModule::Packet))) {
+        const auto& pkt = incomingPacket.getPacket();
+        // a server not running in raw mode would send frames here instead
+        if (pkt.nb_client < 0 || pkt.nb_client > MAX_CLIENTS || pkt.client_id < 0 || pkt.client_id >= MAX_CLIENTS) {
+            std::cerr << "[CLIENT] Invalid packet from server" << std::endl;
+            return FUNC_ERROR;
+        }
+        received = 1;
+    }
+    return received;
+}
+
+int ClientModule::Client::receiveFrames(PacketModule& incomingPacket) {
+    // drain every queued message, only the newest snapshot matters
+    int received = 0;
+    uint8_t type;
+    const uint8_t* payload;
+    size_t size;
+    while (true) {
+        int result = stream.nextFrame(type, payload, size);
+        if (result == 0) {
+            return received;
+        }
+        if (result < 0) {
+            std::cerr << "[CLIENT] Invalid message from server" << std::endl;
+            return FUNC_ERROR;
+        }
+        if (type >= Protocol::MAP_BEGIN && type <= Protocol::MAP_END) {
+            receivedChunks.clear();
+            if (!mapReceiver.feed(type, payload, size, receivedChunks)) {
+                std::cerr << "[CLIENT] Invalid map transfer from server" << std::endl;
+                return FUNC_ERROR;
+            }
+            if (!receivedChunks.empty()) {
+                std::lock_guard<std::mutex> lock(_chunkMutex);
+                std::move(receivedChunks.begin(), receivedChunks.end(), std::back_inserter(mapChunks));
+            }
+            if (debugMode && type == Protocol::MAP_BEGIN) {
+                std::cout << "[CLIENT] Map " << mapReceiver.getWidth() << "x" << mapReceiver.getHeight() << std::endl;
+            }
+            if (mapReceiver.isComplete()) {
+                if (debugMode) {
+                    std::cout << "[CLIENT] Received the whole map" << std::endl;
+                }
+                // in raw mode the stream switches to Packet structs right after
+                if (rawMode) {
+                    return received;
+                }
+            }
+        } else if (type == Protocol::SNAPSHOT) {
+            if (!decoder.decode(payload, size, incomingPacket.getPacket())) {
+                std::cerr << "[CLIENT] Invalid snapshot from server" << std::endl;
+                return FUNC_ERROR;
+            }
+            received = 1;
+        }
+    }
+}
+
+void ClientModule::Client::applyIncomingPacket(PacketModule& incomingPacket) {
+    if (debugMode) {
+        std::cout << "[CLIENT] Received packet from server" << std::endl;
+        incomingPacket.display("[CLIENT] Received: ");
+    }
+    
+    if (id == -1) {
+        id = incomingPacket.getClientId();
+        if (debugMode) {
+            std::cout << "[CLIENT] client ID: " << id << std::endl;
+        }
+    }
+    
+    // Copy all data from incoming packet, but preserve local player position and input
+    auto localPos = packet.getPacket().playerPosition[id];
+    bool localJetpack = packet.getPacket().jetpack;
+    packet = incomingPacket;
+    copiedBytes += sizeof(PacketModule::Packet);
+    packet.getPacket().jetpack = localJetpack;
+    
+    // Only override local position if game state changed from WAITING to PLAYING
+    if (incomingPacket.getstate() == PacketModule::PLAYING && 
+        packet.getstate() == PacketModule::WAITING) {
+        // We're transitioning to PLAYING, keep position
+    } else if (incomingPacket.getstate() == PacketModule::WAITING) {
+        // Reset position if in WAITING state
+        packet.getPacket().playerPosition[id] = std::make_pair(100, 300);
+    } else {
+        // Otherwise use local position in PLAYING state
+        packet.getPacket().playerPosition[id] = localPos;
+    }
+    
+    if (debugMode) {
+        if (incomingPacket.getstate() == PacketModule::PLAYING && 
+            packet.getstate() == PacketModule::WAITING) {
+            std::cout << "[CLIENT] Game state changed to PLAYING!" << std::endl;
+        }
+    }
+    // the renderer picks it up on its next frame, nobody waits
+    ServerUpdate& update = sharedState.snapshots.writeBuffer();
+    update.packet = packet;
+    update.hasAck = !rawMode;
+    update.ack = decoder.getAck();
+    update.stepRate = mapReceiver.getStepRate();
+    update.step = decoder.getStep();
+    update.arrival = std::chrono::steady_clock::now();
+    sharedState.snapshots.publish();
+    copiedBytes += sizeof(PacketModule::Packet);
+}
+
+void ClientModule::Client::wakeNetworkThread() {
+    wake(wakeFd);
+}
+
+bool ClientModule::Client::applyLocalInput() {
+    if (!sharedState.input.update()) {
+        return false;
+    }
+    LocalInput previous = localInput;
+    localInput = sharedState.input.read();
+    packet.getPacket().jetpack = localInput.jetpack;
+    if (id >= 0) {
+        packet.getPacket().playerPosition[id] = localInput.position;
+        if (localInput.ended) {
+            packet.getPacket().playerState[id] = PacketModule::ENDED;
+        }
+    }
+    // a snapshot mode input only carries the jetpack and the stamped inputs
+    return rawMode ? localInput != previous
+        : localInput.jetpack != previous.jetpack || localInput.inputSeq != previous.inputSeq;
+}
+
+int ClientModule::Client::sendUpdate(PacketModule& outgoingPacket) {
+    outgoingPacket = packet;
+    if (rawMode) {
+        output.appendBytes(&outgoingPacket.getPacket(), sizeof(PacketModule::Packet));
+    } else {
+        // input and the last snapshot received, the server deltas against it
+        Protocol::Input input;
+        input.ack = decoder.getLastSeq();
+        input.jetpack = outgoingPacket.getPacket().jetpack;
+        // the inputs stamped since the last message, past MAX_INPUT_HISTORY
+        // the oldest are lost and the server reconciliation covers them
+        uint16_t fresh = localInput.inputSeq - sentInputSeq;
+        if (fresh > 0) {
+            input.seq = localInput.inputSeq;
+            input.count = std::min<int>(fresh, Protocol::MAX_INPUT_HISTORY);
+            input.history = localInput.inputHistory;
+        }
+        Protocol::encodeInput(input, inputBuffer);
+        output.append(Protocol::INPUT, inputBuffer.data(), inputBuffer.size());
+        sentInputSeq = localInput.inputSeq;
+    }
+    // queued behind anything the socket did not take last time
+    ssize_t result = output.flush(fd);
+    if (result < 0) {
+        if (debugMode) {
+            std::cerr << "[CLIENT] Send error: " << strerror(errno) << std::endl;
+        }
+        return FUNC_ERROR;
+    }
+    if (debugMode) {
+        outgoingPacket.display("[CLIENT] Sent: ");
+    }
+    return result;
+}
+
 void ClientModule::Client::networkThread() {
     if (debugMode) {
         std::cout << "[CLIENT] Network thread started" << std::endl;
@@ -109,81 +317,71 @@ void ClientModule::Client::networkThread() {
     PacketModule outgoingPacket;
     int flags = fcntl(fd, F_GETFL, 0);
     fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    // sleeps in poll until the server sends something or the game thread
+    // signals new input; changes are coalesced into one update per
+    // SEND_INTERVAL, nothing is sent while nothing changes
+    auto poller = Poller::create("poll");
+    poller->add(fd);
+    poller->add(wakeFd);
+    std::vector<int> ready;
+    bool dirty = true;
+    auto nextSend = std::chrono::steady_clock::now();
     while (connected && !g_shutdown) {
-        int result = recv(fd, &incomingPacket, sizeof(PacketModule::Packet), MSG_DONTWAIT);
-        if (result > 0) {
-            if (debugMode) {
-                std::lock_guard<std::mutex> lock(_packetMutex);
-                std::cout << "[CLIENT] Received packet from server" << std::endl;
-                incomingPacket.display("[CLIENT] Received: ");
+        int timeout = -1;
+        if (dirty) {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(nextSend - std::chrono::steady_clock::now());
+            timeout = std::max(0, static_cast<int>(wait.count()));
+        }
+        if (poller->wait(ready, timeout) < 0 && errno != EINTR) {
+            connected = false;
+            break;
+        }
+        for (int readyFd : ready) {
+            if (readyFd == wakeFd) {
+                uint64_t count;
+                if (read(wakeFd, &count, sizeof(count)) < 0) {
+                    // already drained
+                }
+                continue;
             }
-            {
-                std::lock_guard<std::mutex> lock(_packetMutex);
-                
-                if (id == -1) {
-                    id = incomingPacket.getClientId();
+            // a full buffer is drained, then filled again
+            bool full = true;
+            while (connected && full) {
+                if (stream.fill(fd) < 0) {
                     if (debugMode) {
-                        std::cout << "[CLIENT] client ID: " << id << std::endl;
+                        std::cerr << "[CLIENT] Connection lost" << std::endl;
                     }
+                    connected = false;
+                    break;
                 }
-                
-                // Copy all data from incoming packet, but preserve local player position
-                auto localPos = packet.getPacket().playerPosition[id];
-                packet = incomingPacket;
-                
-                // Only override local position if game state changed from WAITING to PLAYING
-                if (incomingPacket.getstate() == PacketModule::PLAYING && 
-                    packet.getstate() == PacketModule::WAITING) {
-                    // We're transitioning to PLAYING, keep position
-                } else if (incomingPacket.getstate() == PacketModule::WAITING) {
-                    // Reset position if in WAITING state
-                    packet.getPacket().playerPosition[id] = std::make_pair(100, 300);
-                } else {
-                    // Otherwise use local position in PLAYING state
-                    packet.getPacket().playerPosition[id] = localPos;
+                full = stream.isFull();
+                int result = rawMode ? receiveRawPacket(incomingPacket) : receiveFrames(incomingPacket);
+                if (result < 0) {
+                    connected = false;
+                    break;
                 }
-                
-                if (debugMode) {
-                    if (incomingPacket.getstate() == PacketModule::PLAYING && 
-                        packet.getstate() == PacketModule::WAITING) {
-                        std::cout << "[CLIENT] Game state changed to PLAYING!" << std::endl;
-                    }
+                if (result > 0) {
+                    applyIncomingPacket(incomingPacket);
+                    // the server deltas against the last snapshot we acknowledge
+                    dirty |= !rawMode;
                 }
             }
-        } else if (result == -1) {
-            if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                if (debugMode) {
-                    std::cerr << "[CLIENT] Network error: " << strerror(errno) << std::endl;
-                }
-                connected = false;
-                break;
-            }
-        } else if (result == 0) {
-            if (debugMode) {
-                std::cout << "[CLIENT] Server closed connection" << std::endl;
-            }
+        }
+        // what the socket did not take last time goes out as soon as it can
+        if (connected && !output.empty() && output.flush(fd) < 0) {
             connected = false;
             break;
         }
-        {
-            std::lock_guard<std::mutex> lock(_packetMutex);
-            outgoingPacket = packet;
-        }
-        result = send(fd, &outgoingPacket, sizeof(PacketModule::Packet), MSG_DONTWAIT);
-        if (result == -1) {
-            if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                if (debugMode) {
-                    std::cerr << "[CLIENT] Send error: " << strerror(errno) << std::endl;
-                }
+        dirty |= applyLocalInput();
+        auto now = std::chrono::steady_clock::now();
+        if (connected && dirty && now >= nextSend) {
+            if (sendUpdate(outgoingPacket) < 0) {
                 connected = false;
                 break;
             }
+            dirty = false;
+            nextSend = now + SEND_INTERVAL;
         }
-        if (debugMode) {
-            std::lock_guard<std::mutex> lock(_packetMutex);
-            outgoingPacket.display("[CLIENT] Sent: ");
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
     if (debugMode) {
         std::cout << "[CLIENT] Network thread stopped" << std::endl;
@@ -0,0 +1,118 @@
+#include "../shared_include/Interpolation.hpp"
+#include <algorithm>
+#include <cmath>
+
+// target delay: one snapshot interval plus this many times the jitter
+static const double JITTER_FACTOR = 4.0;
+static const double MIN_DELAY = 0.02;
+static const double MAX_DELAY = 0.5;
+// the delay moves by at most 5% of the elapsed time, playback runs at 95-105%
+static const double ADJUST_RATE = 0.05;
+// how fast the clock offset may drift up between snapshots, in seconds per second
+static const double OFFSET_CREEP = 0.01;
+// the server broadcast rate, until measured
+static const double DEFAULT_INTERVAL = 1.0 / 30;
+// weight of a new measurement in the running averages, as in RFC 3550
+static const double SMOOTHING = 1.0 / 16;
+
+Interpolation::PlayoutClock::PlayoutClock()
+{
+    reset();
+}
+
+void Interpolation::PlayoutClock::reset()
+{
+    _started = false;
+    _offset = 0;
+    _jitter = 0;
+    _interval = DEFAULT_INTERVAL;
+    _delay = DEFAULT_INTERVAL;
+    _lastServerTime = 0;
+    _lastArrival = 0;
+    _lastUpdate = 0;
+}
+
+void Interpolation::PlayoutClock::observe(double serverTime, double arrival)
+{
+    double transit = arrival - serverTime;
+    if (!_started) {
+        _started = true;
+        _offset = transit;
+        _lastUpdate = arrival;
+    } else {
+        // a state resent without a simulation step in between says nothing about timing
+        if (serverTime <= _lastServerTime) {
+            return;
+        }
+        double spacing = serverTime - _lastServerTime;
+        double deviation = (arrival - _lastArrival) - spacing;
+        _jitter += (std::fabs(deviation) - _jitter) * SMOOTHING;
+        _interval += (spacing - _interval) * SMOOTHING;
+        _offset = std::min(_offset, transit);
+    }
+    _lastServerTime = serverTime;
+    _lastArrival = arrival;
+}
+
+void Interpolation::PlayoutClock::update(double now)
+{
+    if (!_started) {
+        return;
+    }
+    double elapsed = std::max(now - _lastUpdate, 0.0);
+    _lastUpdate = now;
+    _offset += OFFSET_CREEP * elapsed;
+    double target = std::min(std::max(_interval + JITTER_FACTOR * _jitter, MIN_DELAY), MAX_DELAY);
+    double step = ADJUST_RATE * elapsed;
+    _delay += std::min(std::max(target - _delay, -step), step);
+}
+
+void Interpolation::EntityHistory::push(double time, float x, float y)
+{
+    if (_count > 0 && time <= at(0).time) {
+        return;
+    }
+    _samples[_next] = {time, x, y};
+    _next = (_next + 1) % SIZE;
+    _count = std::min(_count + 1, SIZE);
+}
+
+bool Interpolation::EntityHistory::sample(double time, float& x, float& y, bool* extrapolated) const
+{
+    if (extrapolated) {
+        *extrapolated = false;
+    }
+    if (_count == 0) {
+        return false;
+    }
+    const Sample& newest = at(0);
+    if (time >= newest.time) {
+        x = newest.x;
+        y = newest.y;
+        if (_count > 1 && time > newest.time) {
+            // a late or lost snapshot, the last motion goes on for a while
+            const Sample& previous = at(1);
+            double ahead = std::min(time - newest.time, MAX_EXTRAPOLATION) / (newest.time - previous.time);
+            x += static_cast<float>((newest.x - previous.x) * ahead);
+            y += static_cast<float>((newest.y - previous.y) * ahead);
+            if (extrapolated) {
+                *extrapolated = true;
+            }
+        }
+        return true;
+    }
+    for (size_t age = 1; age < _count; ++age) {
+        const Sample& older = at(age);
+        if (older.time <= time) {
+            const Sample& newer = at(age - 1);
+            float alpha = static_cast<float>((time - older.time) / (newer.time - older.time));
+            x = older.x + (newer.x - older.x) * alpha;
+            y = older.y + (newer.y - older.y) * alpha;
+            return true;
+        }
+    }
+    // further back than the history, the oldest snapshot is held
+    x = at(_count - 1).x;
+    y = at(_count - 1).y;
+    return true;
+}
@@ -0,0 +1,152 @@
+#include "../shared_include/MapScan.hpp"
+#include <atomic>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#define MAPSCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    const int BLOCK = 32;
+    static_assert(GameMap::ROW_ALIGN % BLOCK == 0, "rows must hold whole blocks");
+
+    // a kernel is built for the one or two tile codes searched and returns
+    // the mask of the 32 tiles of an aligned block equal to either of them
+    struct ScalarKernel {
+        ScalarKernel(uint8_t a, uint8_t b) : _a(a), _b(b) {}
+        uint32_t match(const uint8_t* block) const {
+            uint32_t mask = 0;
+            for (int i = 0; i < BLOCK; ++i) {
+                mask |= static_cast<uint32_t>(block[i] == _a || block[i] == _b) << i;
+            }
+            return mask;
+        }
+        uint8_t _a;
+        uint8_t _b;
+    };
+
+#ifdef MAPSCAN_X86
+    struct Sse2Kernel {
+        __attribute__((target("sse2")))
+        Sse2Kernel(uint8_t a, uint8_t b) : _a(_mm_set1_epi8(static_cast<char>(a))), _b(_mm_set1_epi8(static_cast<char>(b))) {}
+        __attribute__((target("sse2")))
+        uint32_t match(const uint8_t* block) const {
+            __m128i low = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+            __m128i high = _mm_load_si128(reinterpret_cast<const __m128i*>(block + 16));
+            uint32_t lowMask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(low, _a), _mm_cmpeq_epi8(low, _b)));
+            uint32_t highMask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(high, _a), _mm_cmpeq_epi8(high, _b)));
+            return lowMask | highMask << 16;
+        }
+        __m128i _a;
+        __m128i _b;
+    };
+
+    struct Avx2Kernel {
+        __attribute__((target("avx2")))
+        Avx2Kernel(uint8_t a, uint8_t b) : _a(_mm256_set1_epi8(static_cast<char>(a))), _b(_mm256_set1_epi8(static_cast<char>(b))) {}
+        __attribute__((target("avx2")))
+        uint32_t match(const uint8_t* block) const {
+            __m256i tiles = _mm256_load_si256(reinterpret_cast<const __m256i*>(block));
+            __m256i equal = _mm256_or_si256(_mm256_cmpeq_epi8(tiles, _a), _mm256_cmpeq_epi8(tiles, _b));
+            return static_cast<uint32_t>(_mm256_movemask_epi8(equal));
+        }
+        __m256i _a;
+        __m256i _b;
+    };
+#endif
+
+    // bits of the block starting at column base that fall in [first, last)
+    uint32_t rangeMask(int base, int first, int last)
+    {
+        uint64_t mask = ~0ull;
+        if (first > base) {
+            mask <<= first - base;
+        }
+        if (last < base + BLOCK) {
+            mask &= (1ull << (last - base)) - 1;
+        }
+        return static_cast<uint32_t>(mask);
+    }
+
+    // blocks are aligned on the row start, padding tiles are EMPTY and masked out anyway
+    template <typename Kernel>
+    void findTilesWith(const GameMap& map, TileType a, TileType b, int first, int last, std::vector<MapScan::Cell>& out)
+    {
+        first = std::max(first, 0);
+        last = std::min(last, map.width);
+        Kernel kernel(static_cast<uint8_t>(a), static_cast<uint8_t>(b));
+        for (int y = 0; y < map.height; ++y) {
+            const uint8_t* row = map.row(y);
+            for (int base = first & ~(BLOCK - 1); base < last; base += BLOCK) {
+                uint32_t mask = kernel.match(row + base) & rangeMask(base, first, last);
+                for (; mask; mask &= mask - 1) {
+                    int x = base + __builtin_ctz(mask);
+                    out.push_back({x, y, static_cast<TileType>(row[x])});
+                }
+            }
+        }
+    }
+
+    using FindTiles = void (*)(const GameMap&, TileType, TileType, int, int, std::vector<MapScan::Cell>&);
+
+    FindTiles findTilesFor(MapScan::Level level)
+    {
+        switch (level) {
+#ifdef MAPSCAN_X86
+            case MapScan::Level::AVX2:
+                return findTilesWith<Avx2Kernel>;
+            case MapScan::Level::SSE2:
+                return findTilesWith<Sse2Kernel>;
+#endif
+            default:
+                return findTilesWith<ScalarKernel>;
+        }
+    }
+
+    std::atomic<MapScan::Level>& currentLevel()
+    {
+        static std::atomic<MapScan::Level> level(MapScan::detect());
+        return level;
+    }
+};
+
+MapScan::Level MapScan::detect()
+{
+#ifdef MAPSCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Level::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return Level::SSE2;
+    }
+#endif
+    return Level::SCALAR;
+}
+
+MapScan::Level MapScan::getLevel()
+{
+    return currentLevel().load(std::memory_order_relaxed);
+}
+
+void MapScan::setLevel(Level level)
+{
+    currentLevel().store(std::min(level, detect()), std::memory_order_relaxed);
+}
+
+const char *MapScan::name(Level level)
+{
+    switch (level) {
+        case Level::AVX2:
+            return "avx2";
+        case Level::SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+void MapScan::findTiles(const GameMap& map, TileType a, TileType b, int firstColumn, int lastColumn, std::vector<Cell>& out)
+{
+    findTilesFor(getLevel())(map, a, b, firstColumn, lastColumn, out);
+}
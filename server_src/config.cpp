@@ -1,4 +1,5 @@
 #include "../shared_include/Config.hpp"
+#include "../shared_include/Error.hpp"
 #include <stdexcept>
 #include <iostream>
 #include <unistd.h>
@@ -7,7 +8,7 @@
 void ServerConfig::parseArgs(int argc, char* argv[])
 {
     int opt;
-    while ((opt = getopt(argc, argv, "p:m:d")) != -1) {
+    while ((opt = getopt(argc, argv, "p:m:db:w:s:t:rl:")) != -1) {
         switch (opt) {
             case 'p':
                 port = parsePort(optarg);
@@ -18,6 +19,24 @@ void ServerConfig::parseArgs(int argc, char* argv[])
             case 'd':
                 debug_mode = true;
                 break;
+            case 'b':
+                backend = optarg;
+                break;
+            case 'w':
+                workers = parseCount(optarg, 1, 1024, "worker count");
+                break;
+            case 's':
+                room_size = parseCount(optarg, 1, MAX_CLIENTS - 1, "room size");
+                break;
+            case 't':
+                tick_rate = parseCount(optarg, 1, 1000, "tick rate");
+                break;
+            case 'r':
+                raw_packets = true;
+                break;
+            case 'l':
+                parseSlowLimits(optarg);
+                break;
             case '?':
                 printUsage(argv[0]);
                 throw std::runtime_error("Invalid arguments");
@@ -32,13 +51,6 @@ void ServerConfig::parseArgs(int argc, char* argv[])
     validate();
 }
 
-void ServerConfig::loadMap() const
-{
-    if (access(map_file.c_str(), R_OK) != 0) {
-        throw std::runtime_error("Cannot access map file: " + map_file);
-    }
-}
-
 int ServerConfig::parsePort(const std::string& port_str)
 {
     try {
@@ -52,19 +64,58 @@ int ServerConfig::parsePort(const std::string& port_str)
     }
 }
 
+int ServerConfig::parseCount(const std::string& value, int min, int max, const std::string& what)
+{
+    try {
+        int count = std::stoi(value);
+        if (count < min || count > max) {
+            throw std::out_of_range(what + " out of range");
+        }
+        return count;
+    } catch (const std::exception&) {
+        throw std::runtime_error("Invalid " + what + ": " + value);
+    }
+}
+
+void ServerConfig::parseSlowLimits(const std::string& value)
+{
+    // mark,degrade,evict
+    size_t first = value.find(',');
+    size_t second = first == std::string::npos ? std::string::npos : value.find(',', first + 1);
+    if (second == std::string::npos) {
+        throw std::runtime_error("Invalid slow client limits: " + value);
+    }
+    slow_mark_ms = parseCount(value.substr(0, first), 1, 600000, "slow client mark limit");
+    slow_degrade_ms = parseCount(value.substr(first + 1, second - first - 1), 1, 600000, "slow client degrade limit");
+    slow_evict_ms = parseCount(value.substr(second + 1), 1, 600000, "slow client evict limit");
+    if (slow_mark_ms > slow_degrade_ms || slow_degrade_ms > slow_evict_ms) {
+        throw std::runtime_error("Slow client limits must be increasing: " + value);
+    }
+}
+
 void ServerConfig::validate() const
 {
     if (map_file.empty()) {
         throw std::runtime_error("Map file cannot be empty");
     }
+    if (backend != "poll" && backend != "epoll") {
+        throw std::runtime_error("Invalid event backend: " + backend);
+    }
 }
 
 void ServerConfig::printUsage(const std::string& program_name)
 {
     std::cerr << "Usage: " << program_name 
-              << " -p <port> -m <map> [-d]\n"
+              << " -p <port> -m <map> [-d] [-b <backend>] [-w <workers>] [-s <size>] [-t <rate>] [-r] [-l <ms,ms,ms>]\n"
               << "Options:\n"
               << "  -p <port>    Server port (1-65535)\n"
               << "  -m <map>     Map file to load\n"
-              << "  -d           Enable debug mode\n";
+              << "  -d           Enable debug mode\n"
+              << "  -b <backend> Event loop backend: epoll (default on Linux) or poll\n"
+              << "  -w <workers> Room worker threads (default: one per core)\n"
+              << "  -s <size>    Players per room (default 2)\n"
+              << "  -t <rate>    Simulation ticks per second (default 60)\n"
+              << "  -r           Raw Packet struct protocol, for clients started with -r\n"
+              << "  -l <m,d,e>   Ms a client may stay behind before it is marked slow, gets\n"
+              << "               fewer updates, is disconnected (default 250,1000,5000)\n";
 }
@@ -0,0 +1,160 @@
+#include "../shared_include/MapCache.hpp"
+#include "../shared_include/Protocol.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+// a chunk of columns has to fit in one MAP_CHUNK frame
+static void checkChunkSize(const MapFormat::PackedMap& tiles)
+{
+    size_t chunkSize = (static_cast<size_t>(MapFormat::CHUNK_COLUMNS) * tiles.height * MapFormat::BITS_PER_TILE + 7) / 8;
+    if (1 + Protocol::MAP_CHUNK_HEADER_SIZE + chunkSize > Protocol::MAX_FRAME_SIZE) {
+        throw std::runtime_error("Map too tall: " + std::to_string(tiles.height) + " rows");
+    }
+}
+
+MapCache::MapCache(const std::string& path) :
+    _path(path), _inotifyFd(-1), _loadDone(false), _loading(false), _reloadAgain(false)
+{
+    _current = load(1);
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    _fileName = slash == std::string::npos ? path : path.substr(slash + 1);
+#ifdef __linux__
+    // the directory is watched, editors often replace the file with a rename
+    _inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotifyFd >= 0 && inotify_add_watch(_inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(_inotifyFd);
+        _inotifyFd = -1;
+    }
+#endif
+}
+
+MapCache::~MapCache()
+{
+    if (_loader.joinable()) {
+        _loader.join();
+    }
+    if (_inotifyFd >= 0) {
+        close(_inotifyFd);
+    }
+}
+
+std::shared_ptr<const MapCache::Map> MapCache::get() const
+{
+    return std::atomic_load(&_current);
+}
+
+bool MapCache::handleEvents()
+{
+    bool changed = false;
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t length = read(_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            if (length < 0 && errno == EINTR) {
+                continue;
+            }
+            return changed;
+        }
+        for (ssize_t offset = 0; offset < length; ) {
+            auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0 && _fileName == event->name) {
+                changed = true;
+            }
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+#endif
+    return changed;
+}
+
+void MapCache::startReload()
+{
+    if (_loading) {
+        _reloadAgain = true;
+        return;
+    }
+    _loading = true;
+    uint32_t version = get()->version + 1;
+    _loader = std::thread([this, version]() {
+        try {
+            _loaded = load(version);
+        } catch (const std::exception& e) {
+            _loadError = e.what();
+        }
+        _loadDone.store(true, std::memory_order_release);
+    });
+}
+
+bool MapCache::finishReload(std::string& error)
+{
+    if (!_loadDone.load(std::memory_order_acquire)) {
+        return false;
+    }
+    _loader.join();
+    _loadDone.store(false, std::memory_order_relaxed);
+    _loading = false;
+    error.clear();
+    if (_loaded) {
+        std::atomic_store(&_current, std::move(_loaded));
+    } else {
+        error.swap(_loadError);
+    }
+    if (_reloadAgain) {
+        _reloadAgain = false;
+        startReload();
+    }
+    return true;
+}
+
+std::shared_ptr<const MapCache::Map> MapCache::load(uint32_t version) const
+{
+    int fd = open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open map file " + _path + ": " + strerror(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Empty or unreadable map file: " + _path);
+    }
+    // read, not mapped: a version must not change or fault if the file is
+    // rewritten while rooms still play on it
+    std::vector<uint8_t> bytes(info.st_size);
+    size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t length = read(fd, bytes.data() + done, bytes.size() - done);
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            close(fd);
+            throw std::runtime_error("Cannot read map file " + _path);
+        }
+        done += length;
+    }
+    close(fd);
+    auto map = std::make_shared<Map>();
+    map->version = version;
+    if (MapFormat::isBinary(bytes.data(), bytes.size())) {
+        map->packed = std::move(bytes);
+        if (!map->tiles.open(map->packed.data(), map->packed.size())) {
+            throw std::runtime_error("Corrupted binary map: " + _path);
+        }
+        checkChunkSize(map->tiles);
+        return map;
+    }
+    std::string text(bytes.begin(), bytes.end());
+    map->packed = MapFormat::pack(GameMap::deserialize(text));
+    map->tiles.open(map->packed.data(), map->packed.size());
+    checkChunkSize(map->tiles);
+    return map;
+}
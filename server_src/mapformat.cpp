@@ -0,0 +1,88 @@
+#include "../shared_include/MapFormat.hpp"
+#include <cstring>
+#include <algorithm>
+
+static void writeLE(uint8_t* out, uint32_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+}
+
+static uint32_t readLE(const uint8_t* data, size_t bytes)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint32_t>(data[i]) << (i * 8);
+    }
+    return value;
+}
+
+bool MapFormat::isBinary(const uint8_t* data, size_t size)
+{
+    return size >= HEADER_SIZE && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+size_t MapFormat::encodedSize(int width, int height)
+{
+    return HEADER_SIZE + (static_cast<size_t>(width) * height * BITS_PER_TILE + 7) / 8;
+}
+
+bool MapFormat::PackedMap::open(const uint8_t* data, size_t size)
+{
+    if (!isBinary(data, size) || readLE(data + 4, 2) != VERSION || readLE(data + 6, 2) != BITS_PER_TILE) {
+        return false;
+    }
+    uint32_t w = readLE(data + 8, 4);
+    uint32_t h = readLE(data + 12, 4);
+    if (w == 0 || h == 0 || w > INT32_MAX || h > INT32_MAX
+        || static_cast<uint64_t>(w) * h > (SIZE_MAX - HEADER_SIZE) / 2 || size < encodedSize(w, h)) {
+        return false;
+    }
+    width = static_cast<int>(w);
+    height = static_cast<int>(h);
+    _tiles = data + HEADER_SIZE;
+    return true;
+}
+
+const uint8_t* MapFormat::PackedMap::getChunk(int index, int& columns, size_t& size) const
+{
+    int first = index * CHUNK_COLUMNS;
+    columns = std::min(CHUNK_COLUMNS, width - first);
+    size = (static_cast<size_t>(columns) * height * BITS_PER_TILE + 7) / 8;
+    return _tiles + static_cast<size_t>(first) * height * BITS_PER_TILE / 8;
+}
+
+std::vector<uint8_t> MapFormat::pack(const GameMap& map)
+{
+    std::vector<uint8_t> out(encodedSize(map.width, map.height), 0);
+    std::memcpy(out.data(), MAGIC, sizeof(MAGIC));
+    writeLE(out.data() + 4, VERSION, 2);
+    writeLE(out.data() + 6, BITS_PER_TILE, 2);
+    writeLE(out.data() + 8, map.width, 4);
+    writeLE(out.data() + 12, map.height, 4);
+    uint8_t* tiles = out.data() + HEADER_SIZE;
+    size_t index = 0;
+    for (int x = 0; x < map.width; ++x) {
+        for (int y = 0; y < map.height; ++y, ++index) {
+            tiles[index / 2] |= static_cast<uint8_t>(map.getTile(x, y)) << (index % 2 * BITS_PER_TILE);
+        }
+    }
+    return out;
+}
+
+GameMap MapFormat::unpack(const PackedMap& packed)
+{
+    GameMap map;
+    map.resize(packed.width, packed.height);
+    for (int x = 0; x < map.width; ++x) {
+        for (int y = 0; y < map.height; ++y) {
+            TileType tile = packed.getTile(x, y);
+            // tile codes this build does not know stay empty
+            if (tile <= TileType::END_MARKER) {
+                map.setTile(x, y, tile);
+            }
+        }
+    }
+    return map;
+}
@@ -90,12 +90,10 @@ void PacketModule::display(std::string info)
                   << pkt.playerPosition[i].second << ") ";
     }
     std::cout << std::endl;
-    
-    if (strlen(pkt.map) > 0 && strlen(pkt.map) < 20) {
-        std::cout << info << " Map: " << pkt.map << std::endl;
-    } else if (strlen(pkt.map) > 0) {
-        std::cout << info << " Map data present (length: " << strlen(pkt.map) << ")" << std::endl;
-    } else {
-        std::cout << info << " No map data" << std::endl;
+
+    std::cout << info << " All player scores: ";
+    for (int i = 0; i < pkt.nb_client; i++) {
+        std::cout << "Player " << i << ": " << pkt.playerScore[i] << " ";
     }
+    std::cout << std::endl;
 }
\ No newline at end of file
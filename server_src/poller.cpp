@@ -0,0 +1,112 @@
+#include "../shared_include/Poller.hpp"
+#include <stdexcept>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+std::unique_ptr<Poller> Poller::create(const std::string& backend)
+{
+#ifdef __linux__
+    if (backend == "epoll") {
+        return std::make_unique<EpollPoller>();
+    }
+#endif
+    if (backend == "poll") {
+        return std::make_unique<PollPoller>();
+    }
+    throw std::runtime_error("Unsupported event backend: " + backend);
+}
+
+void PollPoller::add(int fd)
+{
+    if (_index.count(fd)) {
+        return;
+    }
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    _index[fd] = _fds.size();
+    _fds.push_back(pfd);
+}
+
+void PollPoller::remove(int fd)
+{
+    auto it = _index.find(fd);
+    if (it == _index.end()) {
+        return;
+    }
+    // swap with the last entry so removal stays O(1)
+    size_t pos = it->second;
+    _index.erase(it);
+    if (pos != _fds.size() - 1) {
+        _fds[pos] = _fds.back();
+        _index[_fds[pos].fd] = pos;
+    }
+    _fds.pop_back();
+}
+
+int PollPoller::wait(std::vector<int>& ready, int timeout_ms)
+{
+    ready.clear();
+    int nready = poll(_fds.data(), _fds.size(), timeout_ms);
+    if (nready <= 0) {
+        return nready;
+    }
+    for (const auto& pfd : _fds) {
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            ready.push_back(pfd.fd);
+            if (static_cast<int>(ready.size()) == nready) {
+                break;
+            }
+        }
+    }
+    return static_cast<int>(ready.size());
+}
+
+#ifdef __linux__
+EpollPoller::EpollPoller() : _epollFd(epoll_create1(EPOLL_CLOEXEC)), _events(256)
+{
+    if (_epollFd < 0) {
+        throw std::runtime_error(std::string("Failed to create epoll instance: ") + strerror(errno));
+    }
+}
+
+EpollPoller::~EpollPoller()
+{
+    close(_epollFd);
+}
+
+void EpollPoller::add(int fd)
+{
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = fd;
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0 && errno != EEXIST) {
+        throw std::runtime_error(std::string("Failed to register fd with epoll: ") + strerror(errno));
+    }
+}
+
+void EpollPoller::remove(int fd)
+{
+    // the fd may already be closed, in which case the kernel dropped it for us
+    epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+int EpollPoller::wait(std::vector<int>& ready, int timeout_ms)
+{
+    ready.clear();
+    int nready = epoll_wait(_epollFd, _events.data(), static_cast<int>(_events.size()), timeout_ms);
+    if (nready <= 0) {
+        return nready;
+    }
+    for (int i = 0; i < nready; ++i) {
+        ready.push_back(_events[i].data.fd);
+    }
+    // a full batch means more events are likely queued, grow for the next wakeup
+    if (static_cast<size_t>(nready) == _events.size()) {
+        _events.resize(_events.size() * 2);
+    }
+    return nready;
+}
+#endif
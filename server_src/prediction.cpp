@@ -0,0 +1,104 @@
+#include "../shared_include/Prediction.hpp"
+#include <algorithm>
+#include <cmath>
+
+// a stalled frame runs at most this many steps, the rest of the time is dropped
+static const int MAX_CATCHUP_STEPS = 8;
+
+Prediction::Predictor::Predictor(int stepRate) :
+    _step(1.0f / stepRate), _accumulator(0), _seq(0), _jetpackBits(0), _entries(), _count(0)
+{
+}
+
+void Prediction::Predictor::setStepRate(int stepRate)
+{
+    _step = 1.0f / std::max(stepRate, 1);
+}
+
+void Prediction::Predictor::reset(const Simulation::PlayerState& state)
+{
+    _state = state;
+    _previous = state;
+    _accumulator = 0;
+    _count = 0;
+}
+
+int Prediction::Predictor::advance(float elapsed, bool jetpack)
+{
+    _accumulator += elapsed;
+    int steps = 0;
+    while (_accumulator >= _step && steps < MAX_CATCHUP_STEPS) {
+        _previous = _state;
+        Simulation::stepPlayer(_state, jetpack, _step);
+        _seq++;
+        _jetpackBits = (_jetpackBits << 1) | (jetpack ? 1 : 0);
+        _entries[_seq % HISTORY_SIZE] = {_seq, jetpack, _state};
+        _count = std::min(_count + 1, HISTORY_SIZE);
+        _accumulator -= _step;
+        steps++;
+    }
+    if (steps == MAX_CATCHUP_STEPS) {
+        _accumulator = 0;
+    }
+    return steps;
+}
+
+float Prediction::Predictor::reconcile(uint16_t ackSeq, const Simulation::PlayerState& server)
+{
+    // inputs the server has not run yet, all the known ones if it is further behind
+    size_t pending = std::min(static_cast<size_t>(static_cast<uint16_t>(_seq - ackSeq)), _count);
+    Simulation::PlayerState predicted = _state;
+    _state = server;
+    _previous = server;
+    for (size_t i = pending; i > 0; --i) {
+        Entry& entry = _entries[static_cast<uint16_t>(_seq - i + 1) % HISTORY_SIZE];
+        _previous = _state;
+        Simulation::stepPlayer(_state, entry.jetpack, _step);
+        entry.state = _state;
+    }
+    // the server score is not part of the prediction
+    _state.score = predicted.score;
+    return std::hypot(_state.x - predicted.x, _state.y - predicted.y);
+}
+
+Simulation::PlayerState Prediction::Predictor::getRenderState() const
+{
+    float alpha = std::min(_accumulator / _step, 1.0f);
+    Simulation::PlayerState state = _state;
+    state.x = _previous.x + (_state.x - _previous.x) * alpha;
+    state.y = _previous.y + (_state.y - _previous.y) * alpha;
+    return state;
+}
+
+void Prediction::InputQueue::push(const Protocol::Input& input)
+{
+    if (input.count == 0) {
+        _jetpack = input.jetpack;
+        return;
+    }
+    // messages repeat inputs already queued, only the newer ones are kept
+    for (int i = std::min<int>(input.count, Protocol::MAX_INPUT_HISTORY) - 1; i >= 0; --i) {
+        uint16_t seq = input.seq - i;
+        if (_stamped && !newer(seq, _receivedSeq)) {
+            continue;
+        }
+        _queue.emplace_back(seq, (input.history >> i) & 1);
+        _receivedSeq = seq;
+        _stamped = true;
+    }
+    while (_queue.size() > MAX_QUEUED) {
+        // never run, the client replays what the server reports as used
+        _lastSeq = _queue.front().first;
+        _queue.pop_front();
+    }
+}
+
+bool Prediction::InputQueue::next()
+{
+    if (!_queue.empty()) {
+        _jetpack = _queue.front().second;
+        _lastSeq = _queue.front().first;
+        _queue.pop_front();
+    }
+    return _jetpack;
+}
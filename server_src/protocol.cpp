@@ -0,0 +1,712 @@
+#include "../shared_include/Protocol.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+
+// values of an entity the client has never seen
+static const Protocol::EntityState DEFAULT_ENTITY = {PacketModule::WAITING, 0, 0, 0};
+// version, seq, baseline seq, simulation step, client id, then the own
+// player: input seq, x, y, velocity and the ended flags
+static const size_t SNAPSHOT_HEADER_SIZE = 25;
+static const uint8_t OWN_DEAD = 1 << 0;
+static const uint8_t OWN_FINISHED = 1 << 1;
+
+// per-entity mask of the fields present in a snapshot entry
+static const uint32_t FIELD_STATE = 1 << 0;
+static const uint32_t FIELD_X = 1 << 1;
+static const uint32_t FIELD_Y = 1 << 2;
+static const uint32_t FIELD_SCORE = 1 << 3;
+static const int FIELD_BITS = 4;
+
+static uint32_t clampBits(int32_t value, int bits)
+{
+    int32_t max = static_cast<int32_t>((1u << bits) - 1);
+    return static_cast<uint32_t>(std::min(std::max(value, 0), max));
+}
+
+static void writeU16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+
+static uint16_t readU16(const uint8_t* data)
+{
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+static void writeU32(std::vector<uint8_t>& out, uint32_t value)
+{
+    writeU16(out, value & 0xFFFF);
+    writeU16(out, value >> 16);
+}
+
+static uint32_t readU32(const uint8_t* data)
+{
+    return readU16(data) | (static_cast<uint32_t>(readU16(data + 2)) << 16);
+}
+
+// floats go as their bit pattern, the client replays from the exact state
+static void writeFloat(std::vector<uint8_t>& out, float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    writeU32(out, bits);
+}
+
+static float readFloat(const uint8_t* data)
+{
+    uint32_t bits = readU32(data);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void writeFrameHeader(std::vector<uint8_t>& out, uint8_t type, size_t size)
+{
+    writeU16(out, static_cast<uint16_t>(size + 1));
+    out.push_back(type);
+}
+
+void Protocol::BitWriter::write(uint32_t value, int bits)
+{
+    for (int i = 0; i < bits; ++i) {
+        if (_bit == 0) {
+            _out.push_back(0);
+        }
+        if (value & (1u << i)) {
+            _out.back() |= static_cast<uint8_t>(1u << _bit);
+        }
+        _bit = (_bit + 1) % 8;
+    }
+}
+
+bool Protocol::BitReader::read(uint32_t& value, int bits)
+{
+    if (_pos + bits > _size * 8) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < bits; ++i, ++_pos) {
+        if (_data[_pos / 8] & (1u << (_pos % 8))) {
+            value |= 1u << i;
+        }
+    }
+    return true;
+}
+
+Protocol::Snapshot::Snapshot() : seq(0), clientId(0), nbClient(0), present(0)
+{
+    std::fill_n(entities, MAX_CLIENTS, DEFAULT_ENTITY);
+}
+
+void Protocol::Snapshot::fromPacket(const PacketModule::Packet& pkt, uint16_t sequence)
+{
+    seq = sequence;
+    clientId = clampBits(pkt.client_id, ID_BITS);
+    nbClient = clampBits(std::min(pkt.nb_client, MAX_CLIENTS), ID_BITS);
+    present = 0;
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (i < nbClient) {
+            present |= 1u << i;
+            entities[i].state = clampBits(pkt.playerState[i], STATE_BITS);
+            entities[i].x = clampBits(pkt.playerPosition[i].first, X_BITS);
+            entities[i].y = clampBits(pkt.playerPosition[i].second, Y_BITS);
+            entities[i].score = clampBits(pkt.playerScore[i], SCORE_BITS);
+        } else {
+            entities[i] = DEFAULT_ENTITY;
+        }
+    }
+}
+
+void Protocol::Snapshot::toPacket(PacketModule::Packet& pkt) const
+{
+    pkt.nb_client = nbClient;
+    pkt.client_id = clientId;
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        pkt.playerState[i] = static_cast<PacketModule::gameState>(entities[i].state);
+        pkt.playerPosition[i] = std::make_pair(entities[i].x, entities[i].y);
+        pkt.playerScore[i] = entities[i].score;
+    }
+}
+
+Protocol::SnapshotEncoder::SnapshotEncoder() : _seq(0), _step(0)
+{
+}
+
+void Protocol::SnapshotEncoder::record(const PacketModule::Packet& pkt, uint32_t step)
+{
+    // 0 is reserved for "no baseline"
+    _seq++;
+    if (_seq == 0) {
+        _seq = 1;
+    }
+    _history[_seq % HISTORY_SIZE].fromPacket(pkt, _seq);
+    _step = step;
+    _bodies.clear();
+}
+
+uint16_t Protocol::SnapshotEncoder::baselineFor(uint16_t ack) const
+{
+    uint16_t age = _seq - ack;
+    if (ack != 0 && age > 0 && age < HISTORY_SIZE && _history[ack % HISTORY_SIZE].seq == ack) {
+        return ack;
+    }
+    return 0;
+}
+
+Protocol::SnapshotEncoder::Buffer Protocol::SnapshotEncoder::body(uint16_t ack, uint16_t& baseline)
+{
+    baseline = baselineFor(ack);
+    for (const auto& [seq, buffer] : _bodies) {
+        if (seq == baseline) {
+            return buffer;
+        }
+    }
+    auto buffer = std::make_shared<std::vector<uint8_t>>();
+    encodeBody(baseline, *buffer);
+    _bodies.emplace_back(baseline, buffer);
+    return buffer;
+}
+
+void Protocol::SnapshotEncoder::encodeBody(uint16_t baseline, std::vector<uint8_t>& out) const
+{
+    const Snapshot* base = baseline ? &_history[baseline % HISTORY_SIZE] : nullptr;
+    const Snapshot& current = _history[_seq % HISTORY_SIZE];
+
+    // collect the changed fields first, the entry count comes before them
+    uint32_t masks[MAX_CLIENTS] = {};
+    uint32_t changed = 0;
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (!(current.present & (1u << i))) {
+            continue;
+        }
+        bool known = base && (base->present & (1u << i));
+        const EntityState& ref = known ? base->entities[i] : DEFAULT_ENTITY;
+        const EntityState& cur = current.entities[i];
+        masks[i] = (cur.state != ref.state ? FIELD_STATE : 0) | (cur.x != ref.x ? FIELD_X : 0)
+            | (cur.y != ref.y ? FIELD_Y : 0) | (cur.score != ref.score ? FIELD_SCORE : 0);
+        if (masks[i]) {
+            changed++;
+        }
+    }
+
+    out.clear();
+    BitWriter writer(out);
+    writer.write(current.nbClient, ID_BITS);
+    writer.write(current.present, MAX_CLIENTS);
+    writer.write(changed, ID_BITS);
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (!masks[i]) {
+            continue;
+        }
+        const EntityState& cur = current.entities[i];
+        writer.write(i, ID_BITS);
+        writer.write(masks[i], FIELD_BITS);
+        if (masks[i] & FIELD_STATE) {
+            writer.write(cur.state, STATE_BITS);
+        }
+        if (masks[i] & FIELD_X) {
+            writer.write(cur.x, X_BITS);
+        }
+        if (masks[i] & FIELD_Y) {
+            writer.write(cur.y, Y_BITS);
+        }
+        if (masks[i] & FIELD_SCORE) {
+            writer.write(cur.score, SCORE_BITS);
+        }
+    }
+}
+
+void Protocol::SnapshotEncoder::encodeHeader(uint8_t clientId, uint16_t baseline, size_t bodySize,
+    const PlayerAck& own, std::vector<uint8_t>& out) const
+{
+    out.clear();
+    writeFrameHeader(out, SNAPSHOT, SNAPSHOT_HEADER_SIZE + bodySize);
+    out.push_back(VERSION);
+    writeU16(out, _seq);
+    writeU16(out, baseline);
+    writeU32(out, _step);
+    out.push_back(clampBits(clientId, ID_BITS));
+    writeU16(out, own.inputSeq);
+    writeFloat(out, own.state.x);
+    writeFloat(out, own.state.y);
+    writeFloat(out, own.state.velocity);
+    out.push_back((own.state.dead ? OWN_DEAD : 0) | (own.state.finished ? OWN_FINISHED : 0));
+}
+
+void Protocol::SnapshotEncoder::encodeFrame(uint8_t clientId, uint16_t ack, const PlayerAck& own,
+    std::vector<uint8_t>& out)
+{
+    uint16_t baseline;
+    Buffer encoded = body(ack, baseline);
+    encodeHeader(clientId, baseline, encoded->size(), own, out);
+    out.insert(out.end(), encoded->begin(), encoded->end());
+}
+
+Protocol::SnapshotDecoder::SnapshotDecoder() : _valid(), _lastSeq(0), _step(0)
+{
+}
+
+bool Protocol::SnapshotDecoder::decode(const uint8_t* data, size_t size, PacketModule::Packet& pkt)
+{
+    if (size < SNAPSHOT_HEADER_SIZE || data[0] != VERSION) {
+        return false;
+    }
+    uint16_t seq = readU16(data + 1);
+    uint16_t base = readU16(data + 3);
+    if (seq == 0) {
+        return false;
+    }
+    Snapshot snapshot;
+    if (base != 0) {
+        size_t slot = base % HISTORY_SIZE;
+        if (!_valid[slot] || _history[slot].seq != base) {
+            return false;
+        }
+        snapshot = _history[slot];
+    }
+
+    PlayerAck ack;
+    uint32_t step = readU32(data + 5);
+    uint8_t clientId = data[9];
+    ack.inputSeq = readU16(data + 10);
+    ack.state.x = readFloat(data + 12);
+    ack.state.y = readFloat(data + 16);
+    ack.state.velocity = readFloat(data + 20);
+    ack.state.dead = data[24] & OWN_DEAD;
+    ack.state.finished = data[24] & OWN_FINISHED;
+
+    BitReader reader(data + SNAPSHOT_HEADER_SIZE, size - SNAPSHOT_HEADER_SIZE);
+    uint32_t nbClient, present, changed;
+    if (!reader.read(nbClient, ID_BITS)
+        || !reader.read(present, MAX_CLIENTS) || !reader.read(changed, ID_BITS)) {
+        return false;
+    }
+    // the client indexes its per-player arrays with both
+    if (clientId >= MAX_CLIENTS || nbClient > MAX_CLIENTS) {
+        return false;
+    }
+    // entities that left, or were not in the baseline, start from the defaults
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (!(present & (1u << i)) || !(snapshot.present & (1u << i))) {
+            snapshot.entities[i] = DEFAULT_ENTITY;
+        }
+    }
+    snapshot.seq = seq;
+    snapshot.clientId = clientId;
+    snapshot.nbClient = nbClient;
+    snapshot.present = present;
+    for (uint32_t n = 0; n < changed; ++n) {
+        uint32_t id, mask, value;
+        if (!reader.read(id, ID_BITS) || id >= MAX_CLIENTS || !reader.read(mask, FIELD_BITS)) {
+            return false;
+        }
+        EntityState& entity = snapshot.entities[id];
+        if (mask & FIELD_STATE) {
+            if (!reader.read(value, STATE_BITS)) return false;
+            entity.state = value;
+        }
+        if (mask & FIELD_X) {
+            if (!reader.read(value, X_BITS)) return false;
+            entity.x = value;
+        }
+        if (mask & FIELD_Y) {
+            if (!reader.read(value, Y_BITS)) return false;
+            entity.y = value;
+        }
+        if (mask & FIELD_SCORE) {
+            if (!reader.read(value, SCORE_BITS)) return false;
+            entity.score = value;
+        }
+    }
+    _history[seq % HISTORY_SIZE] = snapshot;
+    _valid[seq % HISTORY_SIZE] = true;
+    _lastSeq = seq;
+    _step = step;
+    _ack = ack;
+    snapshot.toPacket(pkt);
+    return true;
+}
+
+void Protocol::encodeInput(const Input& input, std::vector<uint8_t>& out)
+{
+    out.clear();
+    writeU16(out, input.ack);
+    out.push_back(input.jetpack ? 1 : 0);
+    if (input.count == 0) {
+        return;
+    }
+    writeU16(out, input.seq);
+    out.push_back(input.count);
+    writeU32(out, input.history & 0xFFFFFFFF);
+    writeU32(out, input.history >> 32);
+}
+
+bool Protocol::decodeInput(const uint8_t* data, size_t size, Input& input)
+{
+    if (size < 3) {
+        return false;
+    }
+    input.ack = readU16(data);
+    input.jetpack = data[2] & 1;
+    input.seq = 0;
+    input.count = 0;
+    input.history = 0;
+    // the short form has no stamped inputs
+    if (size == 3) {
+        return true;
+    }
+    if (size < 14 || data[5] == 0 || data[5] > MAX_INPUT_HISTORY) {
+        return false;
+    }
+    input.seq = readU16(data + 3);
+    input.count = data[5];
+    input.history = readU32(data + 6) | (static_cast<uint64_t>(readU32(data + 10)) << 32);
+    return true;
+}
+
+void Protocol::encodeMapBegin(const MapFormat::PackedMap& map, int stepRate, std::vector<uint8_t>& out)
+{
+    writeFrameHeader(out, MAP_BEGIN, 2 * sizeof(uint32_t) + 2 * sizeof(uint16_t));
+    writeU32(out, map.width);
+    writeU32(out, map.height);
+    writeU16(out, MapFormat::CHUNK_COLUMNS);
+    writeU16(out, stepRate);
+}
+
+void Protocol::encodeMapChunk(const MapFormat::PackedMap& map, int index, std::vector<uint8_t>& out)
+{
+    int columns;
+    size_t size;
+    const uint8_t* tiles = map.getChunk(index, columns, size);
+    writeFrameHeader(out, MAP_CHUNK, MAP_CHUNK_HEADER_SIZE + size);
+    writeU32(out, index);
+    out.insert(out.end(), tiles, tiles + size);
+}
+
+void Protocol::encodeMapEnd(std::vector<uint8_t>& out)
+{
+    writeFrameHeader(out, MAP_END, 0);
+}
+
+bool Protocol::MapReceiver::feed(uint8_t type, const uint8_t* data, size_t size,
+    std::vector<MapFormat::MapChunk>& chunks)
+{
+    switch (type) {
+        case MAP_BEGIN:
+            if (size != 2 * sizeof(uint32_t) + 2 * sizeof(uint16_t)) {
+                return false;
+            }
+            _width = static_cast<int>(readU32(data));
+            _height = static_cast<int>(readU32(data + 4));
+            _chunkColumns = readU16(data + 8);
+            _stepRate = readU16(data + 10);
+            if (_width <= 0 || _height <= 0 || _chunkColumns <= 0 || _chunkColumns % 2 != 0 || _stepRate <= 0) {
+                return false;
+            }
+            _nextChunk = 0;
+            _started = true;
+            _complete = false;
+            return true;
+        case MAP_CHUNK: {
+            // chunks come in order, a gap means the stream is broken
+            if (!_started || _complete || size < MAP_CHUNK_HEADER_SIZE
+                || readU32(data) != static_cast<uint32_t>(_nextChunk)) {
+                return false;
+            }
+            int first = _nextChunk * _chunkColumns;
+            int columns = std::min(_chunkColumns, _width - first);
+            size_t expected = (static_cast<size_t>(columns) * _height * MapFormat::BITS_PER_TILE + 7) / 8;
+            if (columns <= 0 || size != MAP_CHUNK_HEADER_SIZE + expected) {
+                return false;
+            }
+            MapFormat::PackedMap packed(data + MAP_CHUNK_HEADER_SIZE, columns, _height);
+            chunks.push_back({first, MapFormat::unpack(packed)});
+            _nextChunk++;
+            return true;
+        }
+        case MAP_END:
+            if (!_started || _nextChunk * _chunkColumns < _width) {
+                return false;
+            }
+            _complete = true;
+            return true;
+        default:
+            return false;
+    }
+}
+
+Protocol::FrameReader::FrameReader(size_t capacity) : _head(0), _tail(0)
+{
+    size_t size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+    _buffer.resize(size);
+}
+
+ssize_t Protocol::FrameReader::fill(int fd)
+{
+    size_t mask = _buffer.size() - 1;
+    ssize_t total = 0;
+    while (!isFull()) {
+        // the free space is at most two pieces, the end and the start of the ring
+        size_t free = _buffer.size() - (_tail - _head);
+        size_t start = _tail & mask;
+        size_t first = std::min(free, _buffer.size() - start);
+        iovec parts[2] = {{_buffer.data() + start, first}, {_buffer.data(), free - first}};
+        msghdr message{};
+        message.msg_iov = parts;
+        message.msg_iovlen = free > first ? 2 : 1;
+        ssize_t bytes_read = recvmsg(fd, &message, MSG_DONTWAIT);
+        if (bytes_read == 0) {
+            return -1;
+        }
+        if (bytes_read < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return total;
+            }
+            return -1;
+        }
+        // a short read is not enough to stop: with edge-triggered epoll a
+        // FIN arriving with the last bytes is reported only once, it is
+        // only seen by reading on until EAGAIN or end of stream
+        _tail += bytes_read;
+        total += bytes_read;
+    }
+    return total;
+}
+
+void Protocol::FrameReader::copyOut(size_t offset, size_t size, uint8_t* out) const
+{
+    size_t start = (_head + offset) & (_buffer.size() - 1);
+    size_t first = std::min(size, _buffer.size() - start);
+    std::memcpy(out, _buffer.data() + start, first);
+    std::memcpy(out + first, _buffer.data(), size - first);
+}
+
+int Protocol::FrameReader::nextFrame(uint8_t& type, const uint8_t*& payload, size_t& size)
+{
+    size_t available = _tail - _head;
+    if (available < FRAME_HEADER_SIZE) {
+        return 0;
+    }
+    uint8_t header[FRAME_HEADER_SIZE];
+    copyOut(0, FRAME_HEADER_SIZE, header);
+    size_t length = readU16(header);
+    size_t total = sizeof(uint16_t) + length;
+    if (length == 0 || total > _buffer.size()) {
+        return -1;
+    }
+    if (available < total) {
+        return 0;
+    }
+    type = header[2];
+    size = length - 1;
+    size_t start = (_head + FRAME_HEADER_SIZE) & (_buffer.size() - 1);
+    if (start + size <= _buffer.size()) {
+        payload = _buffer.data() + start;
+    } else {
+        _scratch.resize(size);
+        copyOut(FRAME_HEADER_SIZE, size, _scratch.data());
+        payload = _scratch.data();
+    }
+    _head += total;
+    return 1;
+}
+
+bool Protocol::FrameReader::nextBytes(void* out, size_t size)
+{
+    if (_tail - _head < size) {
+        return false;
+    }
+    copyOut(0, size, static_cast<uint8_t*>(out));
+    _head += size;
+    return true;
+}
+
+bool Protocol::FrameWriter::append(uint8_t type, const uint8_t* payload, size_t size)
+{
+    if (size + 1 > MAX_FRAME_SIZE) {
+        return false;
+    }
+    writeFrameHeader(_buffer, type, size);
+    _buffer.insert(_buffer.end(), payload, payload + size);
+    return true;
+}
+
+void Protocol::FrameWriter::appendBytes(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    _buffer.insert(_buffer.end(), bytes, bytes + size);
+}
+
+ssize_t Protocol::FrameWriter::flush(int fd)
+{
+    ssize_t total = 0;
+    while (_sent < _buffer.size()) {
+        ssize_t bytes_sent = send(fd, _buffer.data() + _sent, _buffer.size() - _sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (bytes_sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                break;
+            }
+            return -1;
+        }
+        _sent += bytes_sent;
+        total += bytes_sent;
+    }
+    if (_sent == _buffer.size()) {
+        _buffer.clear();
+        _sent = 0;
+    } else if (_sent > 0) {
+        // keep the unsent tail at the front, appends go after it
+        _buffer.erase(_buffer.begin(), _buffer.begin() + _sent);
+        _sent = 0;
+    }
+    return total;
+}
+
+const uint8_t* Protocol::SendQueue::data(const Segment& segment) const
+{
+    return (segment.shared ? segment.shared->data() : _arena.data()) + segment.offset;
+}
+
+void Protocol::SendQueue::append(const void* data, size_t size, uint32_t state)
+{
+    if (size == 0) {
+        return;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    // consecutive copies of the same message stay one piece
+    if (!_segments.empty() && !_segments.back().shared && _segments.back().state == state
+        && _segments.back().offset + _segments.back().size == _arena.size()) {
+        _segments.back().size += size;
+    } else {
+        _segments.push_back({nullptr, _arena.size(), size, state});
+    }
+    _arena.insert(_arena.end(), bytes, bytes + size);
+    _arenaLive += size;
+    _size += size;
+}
+
+void Protocol::SendQueue::append(Buffer buffer, uint32_t state)
+{
+    if (!buffer || buffer->size() < MIN_SHARED_SIZE) {
+        if (buffer) {
+            append(buffer->data(), buffer->size(), state);
+        }
+        return;
+    }
+    _size += buffer->size();
+    size_t size = buffer->size();
+    _segments.push_back({std::move(buffer), 0, size, state});
+}
+
+bool Protocol::SendQueue::pushState(const void* data, size_t size, Buffer body)
+{
+    // a state that started going out has to be finished, the stream
+    // cannot skip the rest of a frame
+    bool replaced = false;
+    for (auto it = _segments.begin(); it != _segments.end();) {
+        if (it->state == 0 || it->state == _startedState) {
+            ++it;
+            continue;
+        }
+        _size -= it->size;
+        if (!it->shared) {
+            _arenaLive -= it->size;
+        }
+        it = _segments.erase(it);
+        replaced = true;
+    }
+    // 0 marks reliable bytes
+    if (++_lastState == 0) {
+        _lastState = 1;
+    }
+    append(data, size, _lastState);
+    append(std::move(body), _lastState);
+    compact();
+    return replaced;
+}
+
+void Protocol::SendQueue::consume(size_t bytes)
+{
+    _size -= bytes;
+    while (bytes > 0) {
+        Segment& front = _segments.front();
+        _startedState = front.state;
+        size_t left = front.size - _sentInFront;
+        if (bytes < left) {
+            _sentInFront += bytes;
+            break;
+        }
+        bytes -= left;
+        if (!front.shared) {
+            _arenaLive -= front.size;
+        }
+        _segments.pop_front();
+        _sentInFront = 0;
+    }
+    compact();
+}
+
+void Protocol::SendQueue::compact()
+{
+    if (_arenaLive == 0) {
+        _arena.clear();
+        return;
+    }
+    if (_arenaLive * 2 > _arena.size()) {
+        return;
+    }
+    std::vector<uint8_t> live;
+    live.reserve(_arenaLive);
+    for (auto& segment : _segments) {
+        if (!segment.shared) {
+            size_t offset = live.size();
+            live.insert(live.end(), _arena.begin() + segment.offset, _arena.begin() + segment.offset + segment.size);
+            segment.offset = offset;
+        }
+    }
+    _arena.swap(live);
+}
+
+ssize_t Protocol::SendQueue::flush(int fd)
+{
+    ssize_t total = 0;
+    while (!_segments.empty()) {
+        iovec parts[MAX_IOVECS];
+        size_t count = 0;
+        size_t requested = 0;
+        for (const auto& segment : _segments) {
+            if (count == MAX_IOVECS) {
+                break;
+            }
+            size_t skip = count == 0 ? _sentInFront : 0;
+            parts[count].iov_base = const_cast<uint8_t*>(data(segment) + skip);
+            parts[count].iov_len = segment.size - skip;
+            requested += parts[count].iov_len;
+            count++;
+        }
+        msghdr message{};
+        message.msg_iov = parts;
+        message.msg_iovlen = count;
+        ssize_t bytes_sent = sendmsg(fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (bytes_sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                break;
+            }
+            return -1;
+        }
+        consume(bytes_sent);
+        total += bytes_sent;
+        // a short write means the socket buffer is full
+        if (static_cast<size_t>(bytes_sent) < requested) {
+            break;
+        }
+    }
+    return total;
+}
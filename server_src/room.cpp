@@ -0,0 +1,365 @@
+#include "../shared_include/Room.hpp"
+#include <algorithm>
+#include <sys/socket.h>
+
+// snapshots go out at ~30Hz whatever the simulation rate is
+static const int SEND_RATE = 30;
+// ticks late by more than this many steps drop the backlog instead of bursting
+static const int MAX_CATCHUP_STEPS = 5;
+// map chunks sent beyond the one under the player
+static const int LOOKAHEAD_CHUNKS = 2;
+// map frames due are queued up to this many bytes, then sent together
+static const size_t MAP_BATCH_SIZE = 64 * 1024;
+// map frames are only queued while less than this is pending
+static const size_t MAX_QUEUED_BYTES = 4 * 1024;
+// a degraded client gets one room state out of this many, ~10Hz
+static const int DEGRADED_SEND_EVERY = 3;
+
+Room::Room(int id, int capacity, std::shared_ptr<const MapCache::Map> map, int tickRate, bool rawPackets,
+    SlowClientLimits limits) :
+    queued(false), _id(id), _capacity(capacity), _map(std::move(map)),
+    _rawPackets(rawPackets), _stepRate(tickRate), _limits(limits),
+    _state(PacketModule::WAITING), _updated(false),
+    _stepDuration(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / tickRate))),
+    _accumulator(0), _lastStep(std::chrono::steady_clock::now()), _steps(0),
+    _sendEvery(std::max(1, tickRate / SEND_RATE)), _ticksSinceSend(0)
+{
+}
+
+PacketModule::gameState Room::getState()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _state;
+}
+
+bool Room::isJoinable()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _state == PacketModule::WAITING && static_cast<int>(_players.size()) < _capacity;
+}
+
+bool Room::isEmpty()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _players.empty();
+}
+
+size_t Room::getPlayerCount()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _players.size();
+}
+
+int Room::addPlayer(int fd)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_state != PacketModule::WAITING || static_cast<int>(_players.size()) >= _capacity) {
+        return -1;
+    }
+    // client ids start at 1 and reuse the lowest free slot
+    int id = 1;
+    while (std::any_of(_players.begin(), _players.end(), [id](const Player& p) { return p.id == id; })) {
+        id++;
+    }
+    Player player;
+    player.fd = fd;
+    player.id = id;
+    player.coins = Simulation::CoinTracker(_map->tiles.height);
+    _players.push_back(std::move(player));
+    updateState();
+    _updated = true;
+
+    // first map chunks then welcome packet, sent under the room lock so
+    // they never interleave with a tick; what the socket buffer cannot
+    // take yet is finished by the next ticks
+    if (streamMap(_players.back())) {
+        _players.back().mapReady = true;
+        broadcast();
+    }
+    return id;
+}
+
+void Room::removePlayer(int fd)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _players.erase(std::remove_if(_players.begin(), _players.end(),
+        [fd](const Player& p) { return p.fd == fd; }), _players.end());
+    updateState();
+    _updated = true;
+}
+
+void Room::updatePlayer(int fd, PacketModule& packetModule)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    // positions and states sent by the client are ignored, only the input is used
+    for (auto& player : _players) {
+        if (player.fd == fd) {
+            Protocol::Input input;
+            input.jetpack = packetModule.getPacket().jetpack;
+            player.inputs.push(input);
+            return;
+        }
+    }
+}
+
+void Room::updateInput(int fd, const Protocol::Input& input)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& player : _players) {
+        if (player.fd == fd) {
+            player.inputs.push(input);
+            if (input.ack != 0) {
+                player.snapshotAck = input.ack;
+            }
+            return;
+        }
+    }
+}
+
+void Room::tick()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (_state == PacketModule::PLAYING) {
+        // fixed timestep: run every step due since the last tick,
+        // whatever the scheduling jitter was
+        _accumulator += now - _lastStep;
+        int steps = 0;
+        while (_accumulator >= _stepDuration && steps < MAX_CATCHUP_STEPS) {
+            step();
+            _accumulator -= _stepDuration;
+            steps++;
+        }
+        if (steps == MAX_CATCHUP_STEPS) {
+            _accumulator = std::chrono::steady_clock::duration(0);
+        }
+    }
+    _lastStep = now;
+    for (auto& player : _players) {
+        // a player whose map just became usable needs the current state
+        if (streamMap(player) && !player.mapReady) {
+            player.mapReady = true;
+            _updated = true;
+        }
+        updatePace(player, now);
+    }
+    if (!_updated || _players.empty() || ++_ticksSinceSend < _sendEvery) {
+        return;
+    }
+    broadcast();
+    _ticksSinceSend = 0;
+    _updated = false;
+}
+
+void Room::step()
+{
+    float dt = std::chrono::duration<float>(_stepDuration).count();
+    _steps++;
+    for (auto& player : _players) {
+        if (player.state.ended()) {
+            continue;
+        }
+        // one stamped input per step, as the client predicted it
+        Simulation::stepPlayer(player.state, player.inputs.next(), dt);
+        Simulation::collide(_map->tiles, player.state, player.coins);
+    }
+    updateState();
+    _updated = true;
+}
+
+void Room::recordTick(std::chrono::microseconds duration, std::chrono::microseconds lag)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint64_t us = duration.count();
+    uint64_t lagUs = lag.count();
+    _stats.ticks++;
+    _stats.totalUs += us;
+    _stats.maxUs = std::max(_stats.maxUs, us);
+    _stats.totalLagUs += lagUs;
+    _stats.maxLagUs = std::max(_stats.maxLagUs, lagUs);
+}
+
+Room::TickStats Room::getStats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    TickStats stats = _stats;
+    _stats = TickStats();
+    return stats;
+}
+
+std::vector<Room::ClientStats> Room::getClientStats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<ClientStats> stats;
+    for (auto& player : _players) {
+        stats.push_back({player.id, player.pace, player.output.size(), player.maxQueued, player.dropped, player.skipped});
+        player.maxQueued = 0;
+        player.dropped = 0;
+        player.skipped = 0;
+    }
+    return stats;
+}
+
+void Room::updateState()
+{
+    if (_state == PacketModule::WAITING && static_cast<int>(_players.size()) >= _capacity) {
+        _state = PacketModule::PLAYING;
+        _accumulator = std::chrono::steady_clock::duration(0);
+        _lastStep = std::chrono::steady_clock::now();
+    } else if (_state == PacketModule::PLAYING) {
+        bool allEnded = std::all_of(_players.begin(), _players.end(),
+            [](const Player& p) { return p.state.ended(); });
+        if (allEnded) {
+            _state = PacketModule::ENDED;
+        }
+    }
+}
+
+void Room::fillPacket(PacketModule::Packet& pkt) const
+{
+    int nb_client = 1;
+    for (const auto& other : _players) {
+        nb_client = std::max(nb_client, other.id + 1);
+        pkt.playerState[other.id] = other.state.ended() ? PacketModule::ENDED : _state;
+        pkt.playerPosition[other.id] = std::make_pair(
+            static_cast<int>(other.state.x), static_cast<int>(other.state.y));
+        pkt.playerScore[other.id] = other.state.score;
+    }
+    pkt.nb_client = nb_client;
+}
+
+void Room::broadcast()
+{
+    PacketModule packetModule;
+    auto& pkt = packetModule.getPacket();
+    fillPacket(pkt);
+    if (!_rawPackets) {
+        _encoder.record(pkt, _steps);
+    }
+    for (auto& player : _players) {
+        if (!player.mapReady || player.evicted) {
+            continue;
+        }
+        if (player.pace == DEGRADED && ++player.degradedTurn % DEGRADED_SEND_EVERY != 0) {
+            player.skipped++;
+            continue;
+        }
+        sendTo(player, pkt);
+        player.maxQueued = std::max(player.maxQueued, player.output.size());
+    }
+}
+
+void Room::updatePace(Player& player, std::chrono::steady_clock::time_point now)
+{
+    if (player.evicted) {
+        return;
+    }
+    if (!player.output.empty()) {
+        if (!player.behind) {
+            player.behind = true;
+            player.behindSince = now;
+        }
+        auto behind = now - player.behindSince;
+        if (behind >= _limits.evict) {
+            // chronically slow, let the event loop see the hang up and remove the client
+            shutdown(player.fd, SHUT_RDWR);
+            player.evicted = true;
+            _stats.evicted++;
+        } else if (behind >= _limits.degrade) {
+            player.pace = DEGRADED;
+        } else if (behind >= _limits.mark && player.pace == KEEPING_UP) {
+            player.pace = MARKED;
+        }
+    } else if (player.behind) {
+        player.behind = false;
+        player.caughtUpSince = now;
+    } else if (player.pace != KEEPING_UP && now - player.caughtUpSince >= _limits.mark) {
+        player.pace = KEEPING_UP;
+    }
+}
+
+bool Room::sendTo(Player& player, PacketModule::Packet& pkt)
+{
+    size_t bytes;
+    bool replaced;
+    size_t before = player.output.size();
+    if (_rawPackets) {
+        pkt.client_id = player.id;
+        bytes = sizeof(pkt);
+        replaced = player.output.pushState(&pkt, sizeof(pkt));
+    } else {
+        // the body is shared by every player with the same baseline, only
+        // the header is this player's
+        uint16_t baseline;
+        auto body = _encoder.body(player.snapshotAck, baseline);
+        Protocol::PlayerAck own;
+        own.inputSeq = player.inputs.getLastSeq();
+        own.state = player.state;
+        _encoder.encodeHeader(player.id, baseline, body->size(), own, _headerBuffer);
+        bytes = _headerBuffer.size() + body->size();
+        replaced = player.output.pushState(_headerBuffer.data(), _headerBuffer.size(), std::move(body));
+    }
+    if (replaced) {
+        player.dropped++;
+        _stats.stateBytesReplaced += before + bytes - player.output.size();
+    }
+    _stats.stateBytesQueued += bytes;
+    return flush(player);
+}
+
+bool Room::flush(Player& player)
+{
+    // a partial write stays queued and goes out first on the next tick
+    ssize_t sent = player.output.flush(player.fd);
+    if (sent < 0) {
+        // let the event loop see the hang up and remove the client
+        shutdown(player.fd, SHUT_RDWR);
+        return false;
+    }
+    _stats.bytesSent += sent;
+    return true;
+}
+
+bool Room::streamMap(Player& player)
+{
+    const auto& tiles = _map->tiles;
+    int chunks = tiles.getChunkCount();
+    int column = static_cast<int>((player.state.x - Simulation::MAP_ORIGIN_X) / Simulation::TILE_SIZE);
+    int lastChunk = std::max(column, 0) / MapFormat::CHUNK_COLUMNS + LOOKAHEAD_CHUNKS;
+    bool due = true;
+    while (true) {
+        // map frames are never dropped, they wait behind at most a few room states
+        if (!flush(player) || player.output.size() >= MAX_QUEUED_BYTES) {
+            return false;
+        }
+        if (!due) {
+            return true;
+        }
+        // frame 0 is MAP_BEGIN, then one frame per chunk, then MAP_END
+        std::vector<uint8_t>& out = _mapBuffer;
+        out.clear();
+        while (out.size() < MAP_BATCH_SIZE) {
+            size_t queued = out.size();
+            if (player.mapFrames == 0) {
+                Protocol::encodeMapBegin(tiles, _stepRate, out);
+            } else if (player.mapFrames <= chunks) {
+                int chunk = player.mapFrames - 1;
+                // raw packet clients need the whole map before their first packet
+                if (!_rawPackets && chunk > lastChunk) {
+                    due = false;
+                    break;
+                }
+                Protocol::encodeMapChunk(tiles, chunk, out);
+            } else if (player.mapFrames == chunks + 1) {
+                Protocol::encodeMapEnd(out);
+            } else {
+                due = false;
+                break;
+            }
+            player.mapFrames++;
+            _stats.mapBytesQueued += out.size() - queued;
+        }
+        player.output.push(out);
+    }
+}
@@ -0,0 +1,134 @@
+#include "../shared_include/RoomScheduler.hpp"
+#include <chrono>
+
+RoomScheduler::RoomScheduler(size_t workers) : _pending(0), _running(false)
+{
+    for (size_t i = 0; i < std::max<size_t>(workers, 1); ++i) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+}
+
+RoomScheduler::~RoomScheduler()
+{
+    stop();
+}
+
+void RoomScheduler::start()
+{
+    std::lock_guard<std::mutex> lock(_wakeMutex);
+    if (_running) {
+        return;
+    }
+    _running = true;
+    for (size_t i = 0; i < _workers.size(); ++i) {
+        _workers[i]->thread = std::thread(&RoomScheduler::workerLoop, this, i);
+    }
+}
+
+void RoomScheduler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_wakeMutex);
+        if (!_running) {
+            return;
+        }
+        _running = false;
+    }
+    _wake.notify_all();
+    for (auto& worker : _workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+        worker->queue.clear();
+    }
+}
+
+void RoomScheduler::schedule(const std::vector<std::shared_ptr<Room>>& rooms)
+{
+    size_t queued = 0;
+    auto now = std::chrono::steady_clock::now();
+    for (const auto& room : rooms) {
+        // a room still waiting from the previous tick is not queued twice
+        if (room->queued.exchange(true)) {
+            continue;
+        }
+        room->scheduledAt = now;
+        auto& worker = *_workers[room->getId() % _workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queue.push_back(room);
+        queued++;
+    }
+    if (queued == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_wakeMutex);
+        _pending += queued;
+    }
+    _wake.notify_all();
+}
+
+std::vector<uint64_t> RoomScheduler::takeStealCounts()
+{
+    std::vector<uint64_t> counts;
+    for (auto& worker : _workers) {
+        counts.push_back(worker->steals.exchange(0));
+    }
+    return counts;
+}
+
+std::shared_ptr<Room> RoomScheduler::popLocal(size_t index)
+{
+    auto& worker = *_workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.queue.empty()) {
+        return nullptr;
+    }
+    auto room = worker.queue.front();
+    worker.queue.pop_front();
+    return room;
+}
+
+std::shared_ptr<Room> RoomScheduler::steal(size_t index)
+{
+    for (size_t offset = 1; offset < _workers.size(); ++offset) {
+        auto& victim = *_workers[(index + offset) % _workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.queue.empty()) {
+            auto room = victim.queue.back();
+            victim.queue.pop_back();
+            _workers[index]->steals++;
+            return room;
+        }
+    }
+    return nullptr;
+}
+
+void RoomScheduler::workerLoop(size_t index)
+{
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_wakeMutex);
+            _wake.wait(lock, [this] { return !_running || _pending > 0; });
+            if (!_running) {
+                return;
+            }
+            // claimed under the wake lock: a woken worker that finds nothing
+            // left to claim goes back to waiting instead of racing for it
+            _pending--;
+        }
+        // rooms are queued before they are counted, so there is one for the
+        // claim; the scan can only pass it while newer rooms are being
+        // claimed, and then it looks again
+        std::shared_ptr<Room> room;
+        while (!(room = popLocal(index)) && !(room = steal(index))) {
+            std::this_thread::yield();
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto lag = std::chrono::duration_cast<std::chrono::microseconds>(start - room->scheduledAt);
+        room->tick();
+        auto end = std::chrono::steady_clock::now();
+        room->recordTick(std::chrono::duration_cast<std::chrono::microseconds>(end - start), lag);
+        room->queued = false;
+    }
+}
@@ -1,7 +1,6 @@
 #include "../shared_include/Server.hpp"
 #include "../shared_include/Packet.hpp"
 #include <iostream>
-#include <fstream>
 #include <sys/cdefs.h>
 #include <sys/poll.h>
 #include <unistd.h>
@@ -14,14 +13,16 @@
 #include <errno.h>
 #include <string.h>
 #include <chrono>
-#include <mutex>
+#include <thread>
+#include <algorithm>
 
-Server::Server(int argc, char* argv[]) : _packetsUpdated(false), _serverFd(-1), _nbClients(1), _running(true)
+Server::Server(int argc, char* argv[]) : _serverFd(-1), _nextRoomId(0), _running(true)
 {
     // Parse command line arguments
     config.parseArgs(argc, argv);
     config.validate();
-    config.loadMap();
+    // parsed once, joins never touch the file
+    _maps = std::make_unique<MapCache>(config.map_file);
 
     // Initialize server socket
     _serverFd = socket(AF_INET, SOCK_STREAM, 0);
@@ -45,8 +46,24 @@ Server::Server(int argc, char* argv[]) : _packetsUpdated(false), _serverFd(-1),
     if (listen(_serverFd, MAX_CLIENTS) < 0) {
         throw std::runtime_error(std::string("Failed to listen on socket: ") + strerror(errno));
     }
+
+    // accept is drained in a loop on each wakeup, so it must never block
+    int flags = fcntl(_serverFd, F_GETFL, 0);
+    fcntl(_serverFd, F_SETFL, flags | O_NONBLOCK);
+    _poller = Poller::create(config.backend);
+    _poller->add(_serverFd);
+    if (_maps->getFd() >= 0) {
+        _poller->add(_maps->getFd());
+    }
+
+    // rooms are ticked on a worker pool, one thread per core by default
+    size_t workers = config.workers > 0 ? config.workers : std::thread::hardware_concurrency();
+    _scheduler = std::make_unique<RoomScheduler>(workers);
+    _scheduler->start();
     if (config.debug_mode) {
-        std::cout << "[SERVER] Server started on port " << config.port << std::endl;
+        std::cout << "[SERVER] Server started on port " << config.port
+                  << " (" << _poller->name() << " backend, "
+                  << _scheduler->getWorkerCount() << " room workers)" << std::endl;
     }
 }
 
@@ -57,32 +74,19 @@ Server::~Server()
 
 void Server::run()
 {
-    // set up poll
-    std::vector<pollfd> poll_fds;
-    pollfd server_pollfd;
-    server_pollfd.fd = _serverFd;
-    server_pollfd.events = POLLIN;
-    poll_fds.push_back(server_pollfd);
+    std::vector<int> ready;
 
-    // set clock for broadcast
-    auto lastBroadcast = std::chrono::steady_clock::now();
+    // rooms are ticked at the fixed simulation rate
+    const auto tickInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / config.tick_rate));
+    auto nextTick = std::chrono::steady_clock::now() + tickInterval;
+    auto lastReport = std::chrono::steady_clock::now();
     
     while (_running) {
-        poll_fds.resize(1); 
-        {
-            // lock the mutex to access the client list
-            std::lock_guard<std::mutex> lock(_clientsMutex);
-            for (auto& client : _fdsList) {
-                pollfd client_pollfd;
-                client_pollfd.fd = client->fd;
-                client_pollfd.events = POLLIN;
-                poll_fds.push_back(client_pollfd);
-            }
-        }
-
-        // poll for events
-        int ready = poll(poll_fds.data(), poll_fds.size(), 100); // 100ms timeout
-        if (ready < 0) {
+        // wait for events, waking up in time for the next tick
+        auto timeout = std::chrono::ceil<std::chrono::milliseconds>(nextTick - std::chrono::steady_clock::now());
+        int nready = _poller->wait(ready, std::max(0, static_cast<int>(timeout.count())));
+        if (nready < 0) {
             if (errno == EINTR) {
                 continue;   
             }
@@ -92,22 +96,31 @@ void Server::run()
             break;
         }
         // check for new connections or data from clients
-        for (size_t i = 0; i < poll_fds.size(); ++i) {
+        for (int fd : ready) {
             if (!_running)
                 break;
-            if (poll_fds[i].revents & POLLIN) {
-                if (poll_fds[i].fd == _serverFd) {
-                    handleNewConnection();
-                } else {
-                    handleClientData(poll_fds[i].fd);
-                }
+            if (fd == _serverFd) {
+                handleNewConnection();
+            } else if (fd == _maps->getFd()) {
+                reloadMap();
+            } else {
+                handleClientData(fd);
             }
         }
-        // broadcast packets to clients
+        // a map loaded since the last wakeup is used by the rooms created from now on
+        installMap();
+        // tick every room, the workers simulate and broadcast to their players
         auto now = std::chrono::steady_clock::now();
-        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastBroadcast).count() >= 33) { // ~30fps
-            broadcastPackets();
-            lastBroadcast = now;
+        if (now >= nextTick) {
+            _scheduler->schedule(_rooms);
+            nextTick += tickInterval;
+            if (nextTick < now) {
+                nextTick = now + tickInterval;
+            }
+        }
+        if (config.debug_mode && now - lastReport >= std::chrono::seconds(5)) {
+            reportRooms(now - lastReport);
+            lastReport = now;
         }
     }
 }
@@ -115,16 +128,18 @@ void Server::run()
 void Server::stop()
 {
     _running = false;
+    // no room may send to a socket once it is closed
+    if (_scheduler) {
+        _scheduler->stop();
+    }
     // close all client sockets
-    std::lock_guard<std::mutex> lock(_clientsMutex);
-    for (auto& client : _fdsList) {
-        shutdown(client->fd, SHUT_RDWR);
-        close(client->fd);
+    for (auto& [fd, room] : _clientRooms) {
+        shutdown(fd, SHUT_RDWR);
+        close(fd);
     }
     // clear local variables
-    _fdsList.clear();
-    _clientIds.clear();
-    _packets.clear();
+    _clientRooms.clear();
+    _rooms.clear();
 
     // close server socket
     if (_serverFd >= 0) {
@@ -137,226 +152,225 @@ void Server::stop()
     }
 }
 
-// Changes to server_src/server.cpp
-
 void Server::handleNewConnection()
 {
-    struct sockaddr_in client_addr;
-    socklen_t client_len = sizeof(client_addr);
+    // drain the accept queue, the listening socket only signals once per batch
+    while (_running) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
 
-    // accept new connection
-    int client_fd = accept(_serverFd, (struct sockaddr*)&client_addr, &client_len);
-    if (client_fd < 0) {
-        if (config.debug_mode) {
-            std::cerr << "[SERVER] Failed to accept connection: " << strerror(errno) << std::endl;
+        int client_fd = accept(_serverFd, (struct sockaddr*)&client_addr, &client_len);
+        if (client_fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK && config.debug_mode) {
+                std::cerr << "[SERVER] Failed to accept connection: " << strerror(errno) << std::endl;
+            }
+            return;
         }
-        return;
+        addClient(client_fd, client_addr);
     }
+}
+
+void Server::addClient(int client_fd, const sockaddr_in &client_addr)
+{
     // Set the client socket to non-blocking mode
     int flags = fcntl(client_fd, F_GETFL, 0);
     fcntl(client_fd, F_SETFL, flags | O_NONBLOCK);
 
-    int client_id = _nbClients++;
-    auto new_pollfd = std::make_shared<pollfd>();
-    new_pollfd->fd = client_fd;
-    new_pollfd->events = POLLIN;
-    _fdsList.push_back(new_pollfd);
-    _clientIds[client_fd] = client_id;
-    
-    // Create a packet for the new client
-    PacketModule welcomePacket(_nbClients);
-    auto& pkt = welcomePacket.getPacket();
-    pkt.nb_client = _nbClients;
-    pkt.client_id = client_id;
-    
-    // Set game state to WAITING if we don't have at least 2 clients
-    if (_nbClients < 3) { // _nbClients is already incremented, so we need 3 (server + 2 clients)
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            pkt.playerState[i] = PacketModule::WAITING;
-        }
-    } else {
-        // If we have 2 clients, set game state to PLAYING for all clients
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            pkt.playerState[i] = PacketModule::PLAYING;
-        }
-        
-        // Update all existing packets to PLAYING state
-        for (auto& [id, packet] : _packets) {
-            auto& existingPkt = packet.getPacket();
-            for (int i = 0; i < MAX_CLIENTS; i++) {
-                existingPkt.playerState[i] = PacketModule::PLAYING;
-            }
-        }
-    }
-    
-    pkt.playerPosition[client_id] = std::make_pair(100, 300); // Set initial position
-
-    // Load the map file into the packet
-    std::ifstream mapFile(config.map_file);
-    if (!mapFile) {
-        throw std::runtime_error("Failed to open map file: " + config.map_file);
-    }
-    mapFile.seekg(0, std::ios::end);
-    std::streamsize file_size = mapFile.tellg();
-    mapFile.seekg(0, std::ios::beg);
-    if (file_size >= MAP_SIZE) {
-        throw std::runtime_error("Map file too large (max " + std::to_string(MAP_SIZE) + " bytes)");
-    }
-    mapFile.read(pkt.map, file_size);
-    pkt.map[file_size] = '\0';
-
-    // send first packet to client
-    if (sendPacket(client_fd, welcomePacket) < 0) {
-        removeClient(client_fd);
-        return;
-    }
+    // place the client in a room that is waiting for players,
+    // the room sends the welcome packet
+    auto room = findRoom();
+    int client_id = room->addPlayer(client_fd);
+    _clientRooms[client_fd] = room;
+    _readers.emplace(client_fd, Protocol::FrameReader(Protocol::SERVER_READ_BUFFER));
+    _poller->add(client_fd);
 
-    _packets.emplace(client_id, welcomePacket);
-    
-    // Mark packets as updated so they'll be broadcast to all clients
-    _packetsUpdated = true;
-    
     if (config.debug_mode) {
         char ip[INET_ADDRSTRLEN];
         inet_ntop(AF_INET, &client_addr.sin_addr, ip, INET_ADDRSTRLEN);
-        std::cout << "[SERVER] New client " << client_id << " from " << ip << std::endl;
-        std::cout << "[SERVER] Total clients: " << _nbClients-1 << ", Game state: " 
-                 << (pkt.playerState[0] == PacketModule::PLAYING ? "PLAYING" : "WAITING") << std::endl;
+        std::cout << "[SERVER] New client " << client_id << " from " << ip
+                  << " in room " << room->getId() << std::endl;
+        std::cout << "[SERVER] Room " << room->getId() << " players: " << room->getPlayerCount()
+                  << ", Game state: "
+                  << (room->getState() == PacketModule::PLAYING ? "PLAYING" : "WAITING") << std::endl;
     }
 }
 
-
-void Server::handleClientData(int client_fd)
+std::shared_ptr<Room> Server::findRoom()
 {
+    auto map = _maps->get();
+    // rooms still on an older map version only finish their match
+    for (const auto& room : _rooms) {
+        if (room->getMapVersion() == map->version && room->isJoinable()) {
+            return room;
+        }
+    }
+    Room::SlowClientLimits limits;
+    limits.mark = std::chrono::milliseconds(config.slow_mark_ms);
+    limits.degrade = std::chrono::milliseconds(config.slow_degrade_ms);
+    limits.evict = std::chrono::milliseconds(config.slow_evict_ms);
+    auto room = std::make_shared<Room>(_nextRoomId++, config.room_size, map,
+        config.tick_rate, config.raw_packets, limits);
+    _rooms.push_back(room);
     if (config.debug_mode) {
-        std::cout << "[SERVER] Handling data from client " << client_fd << std::endl;
+        std::cout << "[SERVER] Created room " << room->getId() << std::endl;
     }
+    return room;
+}
 
-    // check if client is still connected
-    auto it = _clientIds.find(client_fd);
-    if (it == _clientIds.end()) {
-        removeClient(client_fd);
-        return;
+void Server::reloadMap()
+{
+    // parsing a large map would stall the loop, it runs on the cache's helper thread
+    if (_maps->handleEvents()) {
+        _maps->startReload();
     }
+}
 
-    // read packet from client
-    PacketModule pkt(_nbClients);
-    if (!readPacket(client_fd, pkt)) {
-        removeClient(client_fd);
+void Server::installMap()
+{
+    std::string error;
+    if (!_maps->finishReload(error)) {
         return;
     }
-    if (config.debug_mode) {
-        std::cout << "[SERVER] Successfully received packet from client " << it->second << std::endl;
+    if (!error.empty()) {
+        // a half-written or broken file keeps the previous version
+        std::cerr << "[SERVER] Map reload failed: " << error << std::endl;
+    } else if (config.debug_mode) {
+        auto map = _maps->get();
+        std::cout << "[SERVER] Reloaded " << config.map_file << " (version " << map->version
+                  << ", " << map->tiles.width << "x" << map->tiles.height << ")" << std::endl;
     }
-
-    // update packet with client ID
-    _packets.insert_or_assign(it->second, pkt);
-    _packetsUpdated = true;
 }
 
-void Server::removeClient(int client_fd)
+void Server::reportRooms(std::chrono::steady_clock::duration elapsed)
 {
-    // remove client from idsList
-    int client_id = -1;
-    auto id_it = _clientIds.find(client_fd);
-
-    // if client ID exists, remove it from the map
-    if (id_it != _clientIds.end()) {
-        client_id = id_it->second;
-    }
-
-    // remove client from fdsList
-    for (auto it = _fdsList.begin(); it != _fdsList.end(); ++it) {
-        if ((*it)->fd == client_fd) {
-            _fdsList.erase(it);
-            break;
+    // a tick has to fit in one step of the fixed rate
+    const uint64_t budgetUs = 1000000 / config.tick_rate;
+    auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    uint64_t busyUs = 0;
+    for (const auto& room : _rooms) {
+        auto stats = room->getStats();
+        if (stats.ticks == 0) {
+            continue;
+        }
+        busyUs += stats.totalUs;
+        uint64_t avgUs = stats.totalUs / stats.ticks;
+        std::cout << "[SERVER] Room " << room->getId() << ": " << room->getPlayerCount() << " players, "
+                  << stats.ticks << " ticks, tick avg " << avgUs << "us max " << stats.maxUs
+                  << "us (" << (avgUs * 100.0 / budgetUs) << "% of " << budgetUs << "us budget)"
+                  << ", queue lag avg " << stats.totalLagUs / stats.ticks << "us max "
+                  << stats.maxLagUs << "us" << std::endl;
+        size_t players = room->getPlayerCount();
+        if (players > 0 && elapsedUs > 0) {
+            std::cout << "[SERVER] Room " << room->getId() << ": "
+                      << stats.bytesSent * 1000000 / elapsedUs / players << " bytes/s sent per player, "
+                      << stats.bytesSent / stats.ticks << " bytes per tick, states queued "
+                      << stats.stateBytesQueued << " bytes (" << stats.stateBytesReplaced << " overwritten), map queued "
+                      << stats.mapBytesQueued << " bytes, " << stats.evicted << " slow clients evicted" << std::endl;
+        }
+        static const char* const paces[] = {"keeping up", "marked slow", "degraded"};
+        for (const auto& client : room->getClientStats()) {
+            std::cout << "[SERVER] Room " << room->getId() << " client " << client.id << ": "
+                      << paces[client.pace] << ", queue " << client.queuedBytes << " bytes (max "
+                      << client.maxQueuedBytes << "), " << client.dropped << " states overwritten, "
+                      << client.skipped << " skipped" << std::endl;
         }
     }
-    _clientIds.erase(client_fd);
-    if (client_id != -1) {
-        _packets.erase(client_id);
-    }
-    close(client_fd);
-    if (config.debug_mode) {
-        std::cout << "[SERVER] Client disconnected (fd: " << client_fd << ")" << std::endl;
+    auto steals = _scheduler->takeStealCounts();
+    double load = elapsedUs > 0 ? busyUs * 100.0 / (elapsedUs * steals.size()) : 0.0;
+    std::cout << "[SERVER] " << _rooms.size() << " rooms on " << steals.size()
+              << " workers, worker load " << load << "%, steals:";
+    for (auto count : steals) {
+        std::cout << " " << count;
     }
-
-    // decrement the number of clients
-    _nbClients--;
+    std::cout << std::endl;
 }
 
-int Server::sendPacket(int client_fd, PacketModule &packetModule)
+void Server::handleClientData(int client_fd)
 {
-    // create packet to send
-    const auto& pkt = packetModule.getPacket();
-    int bytes_sent = send(client_fd, &pkt, sizeof(pkt), 0);
+    if (config.debug_mode) {
+        std::cout << "[SERVER] Handling data from client " << client_fd << std::endl;
+    }
 
-    if (bytes_sent < 0) {
-        if (config.debug_mode) {
-            std::cerr << "[SERVER] Failed to send packet to client " << client_fd << std::endl;
-        }
-        removeClient(client_fd);
+    // check if client is still connected
+    auto it = _clientRooms.find(client_fd);
+    if (it == _clientRooms.end()) {
+        return;
     }
-    if (config.debug_mode) {
+
+    // read everything queued on the socket, an edge-triggered fd is only
+    // reported again once new data arrives, then handle every complete
+    // message in one pass; a full buffer is drained and filled again
+    Protocol::FrameReader& reader = _readers.at(client_fd);
+    while (true) {
+        ssize_t bytes_read = reader.fill(client_fd);
+        bool full = reader.isFull();
+        if (bytes_read < 0 || !handleMessages(client_fd, reader, *it->second) || (full && reader.isFull())) {
+            if (config.debug_mode) {
+                std::cerr << "[SERVER] Failed to read from client " << client_fd << std::endl;
+            }
+            removeClient(client_fd);
+            return;
+        }
+        if (!full) {
+            return;
+        }
     }
-    return bytes_sent;
 }
 
-bool Server::readPacket(int client_fd, PacketModule &packetModule)
+bool Server::handleMessages(int client_fd, Protocol::FrameReader& reader, Room& room)
 {
-    if (config.debug_mode) {
-        std::cout << "[SERVER] Reading packet from client " << client_fd << std::endl;
-    }
-    // create packet to receive
-    auto& pkt = packetModule.getPacket();
-    ssize_t bytes_read = recv(client_fd, &pkt, sizeof(pkt), MSG_WAITALL);
-
-    if (bytes_read <= 0) {
-        if (config.debug_mode) {
-            std::cerr << "[SERVER] Failed to read packet from client " << client_fd << std::endl;
+    if (config.raw_packets) {
+        PacketModule pkt;
+        // hand the updates to the client's room, it is broadcast on the next tick
+        while (reader.nextBytes(&pkt.getPacket(), sizeof(PacketModule::Packet))) {
+            room.updatePlayer(client_fd, pkt);
         }
-        return false;
+        return true;
     }
-    // check if the entire packet was received
-    if (static_cast<size_t>(bytes_read) != sizeof(pkt)) {
+    uint8_t type;
+    const uint8_t* payload;
+    size_t size;
+    int status;
+    while ((status = reader.nextFrame(type, payload, size)) > 0) {
         if (config.debug_mode) {
-            std::cerr << "[SERVER] Incomplete packet received from client " << client_fd << std::endl;
+            std::cout << "[SERVER] Received message " << static_cast<int>(type)
+                      << " (" << size << " bytes) from client " << client_fd << std::endl;
+        }
+        Protocol::Input input;
+        if (type == Protocol::INPUT && Protocol::decodeInput(payload, size, input)) {
+            room.updateInput(client_fd, input);
         }
-        return false;
-    }
-    if (config.debug_mode) {
-        std::cout << "\n[SERVER] Received packet from client " << client_fd << std::endl;
     }
-    return true;
+    return status == 0;
 }
 
-void Server::broadcastPackets()
+void Server::removeClient(int client_fd)
 {
-    // check if packets have been updated
-    if (!_packetsUpdated)
-        return;
+    auto it = _clientRooms.find(client_fd);
 
-    // If we have at least 2 clients, make sure all are in PLAYING state
-    if (_clientIds.size() >= 2) {
-        // Update all existing packets to PLAYING state
-        for (auto& [id, packet] : _packets) {
-            auto& pkt = packet.getPacket();
-            for (int i = 0; i < MAX_CLIENTS; i++) {
-                if (pkt.playerState[i] != PacketModule::ENDED) {
-                    pkt.playerState[i] = PacketModule::PLAYING;
-                }
-            }
-        }
+    // the client may already have been removed
+    if (it == _clientRooms.end()) {
+        return;
     }
-
-    // send packets to all clients
-    for (auto& client : _fdsList) {
-        if (client->fd != _serverFd) {
-            auto it = _clientIds.find(client->fd);
-            if (it != _clientIds.end()) {
-                sendPacket(client->fd, _packets[it->second]);
-            }
+    auto room = it->second;
+    _clientRooms.erase(it);
+    _readers.erase(client_fd);
+
+    // leave the room before closing so no worker sends to a reused fd
+    room->removePlayer(client_fd);
+    if (room->isEmpty()) {
+        _rooms.erase(std::remove(_rooms.begin(), _rooms.end(), room), _rooms.end());
+        if (config.debug_mode) {
+            std::cout << "[SERVER] Closed room " << room->getId() << std::endl;
         }
     }
-    _packetsUpdated = false;
-}
\ No newline at end of file
+    _poller->remove(client_fd);
+    close(client_fd);
+    if (config.debug_mode) {
+        std::cout << "[SERVER] Client disconnected (fd: " << client_fd << ")" << std::endl;
+    }
+}
+
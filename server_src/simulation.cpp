@@ -0,0 +1,81 @@
+#include "../shared_include/Simulation.hpp"
+#include <cmath>
+#include <algorithm>
+
+void Simulation::stepPlayer(PlayerState& player, bool jetpack, float dt)
+{
+    if (player.ended()) {
+        return;
+    }
+    if (jetpack) {
+        player.velocity = JUMP_VELOCITY;
+    } else {
+        player.velocity += GRAVITY * dt;
+    }
+    player.y += player.velocity * dt;
+    player.x += SCROLL_SPEED * dt;
+    if (player.y < 0) {
+        player.y = 0;
+        player.velocity = 0;
+    } else if (player.y > WORLD_HEIGHT - PLAYER_SIZE) {
+        player.y = WORLD_HEIGHT - PLAYER_SIZE;
+        player.velocity = 0;
+    }
+}
+
+Simulation::CoinTracker::CoinTracker(int height) :
+    _height(height), _firstColumn(0), _taken(static_cast<size_t>(WINDOW_COLUMNS) * height, false)
+{
+}
+
+bool Simulation::CoinTracker::take(int x, int y)
+{
+    if (x < _firstColumn || y < 0 || y >= _height) {
+        return false;
+    }
+    if (x >= _firstColumn + WINDOW_COLUMNS) {
+        // slide the window, the columns left behind free their slots
+        int first = x - WINDOW_COLUMNS + 1;
+        for (int column = _firstColumn; column < std::min(first, _firstColumn + WINDOW_COLUMNS); ++column) {
+            std::fill_n(_taken.begin() + static_cast<size_t>(column % WINDOW_COLUMNS) * _height, _height, false);
+        }
+        _firstColumn = first;
+    }
+    size_t index = static_cast<size_t>(x % WINDOW_COLUMNS) * _height + y;
+    if (_taken[index]) {
+        return false;
+    }
+    _taken[index] = true;
+    return true;
+}
+
+void Simulation::collide(const MapFormat::PackedMap& map, PlayerState& player, CoinTracker& coins)
+{
+    if (player.ended()) {
+        return;
+    }
+    // only the (at most 2x2) tiles overlapped by the player box are visited
+    int minX = static_cast<int>(std::floor((player.x - MAP_ORIGIN_X) / TILE_SIZE));
+    int maxX = static_cast<int>(std::floor((player.x + PLAYER_SIZE - 1 - MAP_ORIGIN_X) / TILE_SIZE));
+    int minY = static_cast<int>(std::floor((player.y - MAP_ORIGIN_Y) / TILE_SIZE));
+    int maxY = static_cast<int>(std::floor((player.y + PLAYER_SIZE - 1 - MAP_ORIGIN_Y) / TILE_SIZE));
+    for (int y = std::max(minY, 0); y <= std::min(maxY, map.height - 1); ++y) {
+        for (int x = std::max(minX, 0); x <= std::min(maxX, map.width - 1); ++x) {
+            switch (map.getTile(x, y)) {
+                case TileType::COIN:
+                    if (coins.take(x, y)) {
+                        player.score++;
+                    }
+                    break;
+                case TileType::ELECTRIC:
+                    player.dead = true;
+                    break;
+                case TileType::END_MARKER:
+                    player.finished = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
@@ -2,12 +2,16 @@
 
 #include <SFML/Graphics.hpp>
 #include <vector>
-#include <map>
-#include <string>
+#include <cmath>
+#include <algorithm>
 
+// A clip: frame rectangles and timing, built once at load and shared
+// (read-only) by everything that plays it. An instance has no state of its
+// own beyond the clip and a phase, its frame is derived from the global
+// AnimationClock, so advancing every animation is one clock update.
 class Animation {
 public:
-    Animation() : currentFrame(0), totalTime(0), frameTime(0.1f), isPlaying(false), isLooped(true) {}
+    Animation() : frameTime(0.1f), isLooped(true) {}
     void addFrame(sf::IntRect rect) {
         frames.push_back(rect);
     }
@@ -17,86 +21,62 @@ public:
     void setLoop(bool loop) {
         isLooped = loop;
     }
-    void play() {
-        isPlaying = true;
-    }
-    void stop() {
-        isPlaying = false;
-        currentFrame = 0;
-        totalTime = 0;
-    }
-    void pause() {
-        isPlaying = false;
-    }
-    void update(float deltaTime) {
-        if (!isPlaying || frames.empty())
-            return;
-
-        totalTime += deltaTime;
-
-        if (totalTime >= frameTime) {
-            totalTime -= frameTime;
-            if (currentFrame + 1 < frames.size())
-                currentFrame++;
-            else {
-                if (isLooped)
-                    currentFrame = 0;
-                else {
-                    currentFrame = frames.size() - 1;
-                    stop();
-                }
-            }
+    // frame shown time seconds after the clip started, a non looped clip stays on its last frame
+    size_t getFrameIndex(float time) const {
+        if (frames.empty() || time <= 0.0f || frameTime <= 0.0f) {
+            return 0;
         }
+        size_t frame = static_cast<size_t>(std::floor(time / frameTime));
+        return isLooped ? frame % frames.size() : std::min(frame, frames.size() - 1);
     }
-    sf::IntRect getCurrentFrame() const {
+    sf::IntRect getFrame(float time) const {
         if (frames.empty())
             return sf::IntRect();
-        return frames[currentFrame];
-    }
-    bool playing() const {
-        return isPlaying;
+        return frames[getFrameIndex(time)];
     }
 
 private:
     std::vector<sf::IntRect> frames;
-    size_t currentFrame;
-    float totalTime;
     float frameTime;
-    bool isPlaying;
     bool isLooped;
 };
+
+// The one time base of every animation, advanced once per frame.
+class AnimationClock {
+public:
+    AnimationClock() : now(0.0f) {}
+    void update(float deltaTime) {
+        now += deltaTime;
+    }
+    float getTime() const {
+        return now;
+    }
+
+private:
+    float now;
+};
+
+// Sprite showing a shared clip, offset by its own phase in seconds.
 class AnimatedSprite : public sf::Sprite {
 public:
-    AnimatedSprite() : animation(nullptr), currentAnimation("") {}
-    void addAnimation(const std::string& name, Animation animation) {
-        animations[name] = animation;
+    AnimatedSprite() : animation(nullptr), phase(0.0f) {}
+    // the clip must outlive the sprite; switching clips keeps the phase
+    void play(const Animation& clip) {
+        animation = &clip;
     }
-    void play(const std::string& name) {
-        if (currentAnimation != name) {
-            if (animations.find(name) != animations.end()) {
-                currentAnimation = name;
-                animation = &animations[name];
-                animation->play();
-                setTextureRect(animation->getCurrentFrame());
-            }
-        }
+    void setPhase(float offset) {
+        phase = offset;
     }
-    void update(float deltaTime) {
-        if (animation && animation->playing()) {
-            animation->update(deltaTime);
-            setTextureRect(animation->getCurrentFrame());
+    void update(const AnimationClock& clock) {
+        if (animation) {
+            setTextureRect(animation->getFrame(clock.getTime() + phase));
         }
     }
-    bool isPlaying() const {
-        return animation && animation->playing();
-    }
-    void stop() {
-        if (animation)
-            animation->stop();
+    bool isPlaying(const Animation& clip) const {
+        return animation == &clip;
     }
 
 private:
-    std::map<std::string, Animation> animations;
-    Animation* animation;
-    std::string currentAnimation;
-};
\ No newline at end of file
+    const Animation* animation;
+    float phase;
+};
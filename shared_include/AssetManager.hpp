@@ -2,32 +2,88 @@
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
+#include "AssetPack.hpp"
+#include "TextureAtlas.hpp"
 #include <string>
 #include <map>
 #include <memory>
 #include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
 
 class AssetManager {
 public:
-    AssetManager() = default;
-    ~AssetManager() = default;
-    
+    // per asset startup cost: decode on a worker, then the render thread
+    // part (texture upload, or copying a sound/font into the manager)
+    struct Timing {
+        std::string name;
+        std::string filename;
+        double decodeMs;
+        double mainMs;
+        bool loaded;
+    };
+
+    // name, kind and loose file of every asset the game uses, also what jetpack_pack packs
+    struct Source {
+        const char* name;
+        AssetPack::Kind kind;
+        const char* filename;
+    };
+    static const std::vector<Source>& defaultAssets() {
+        // the font first, the waiting screen needs it
+        static const std::vector<Source> assets = {
+            {"main", AssetPack::Kind::FONT, "assets/jetpack_font.ttf"},
+            {"player", AssetPack::Kind::TEXTURE, "assets/player_sprite_sheet.png"},
+            {"coin", AssetPack::Kind::TEXTURE, "assets/coins_sprite_sheet.png"},
+            {"electric", AssetPack::Kind::TEXTURE, "assets/zapper_sprite_sheet.png"},
+            {"background", AssetPack::Kind::TEXTURE, "assets/background.png"},
+            {"jump", AssetPack::Kind::SOUND, "assets/jetpack_start.wav"},
+            {"coin", AssetPack::Kind::SOUND, "assets/coin_pickup_1.wav"},
+            {"death", AssetPack::Kind::SOUND, "assets/dud_zapper_pop.wav"},
+            {"jetpack", AssetPack::Kind::SOUND, "assets/jetpack_lp.wav"},
+            {"jetpack_stop", AssetPack::Kind::SOUND, "assets/jetpack_stop.wav"},
+        };
+        return assets;
+    }
+
+    AssetManager() : nextJob(0), pending(0), failed(false) {}
+    ~AssetManager() {
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+
     bool loadTexture(const std::string& name, const std::string& filename) {
         sf::Texture texture;
         if (!texture.loadFromFile(filename)) {
             std::cerr << "Failed to load texture: " << filename << std::endl;
             return false;
         }
-        
+
         textures[name] = texture;
         return true;
     }
-    
+
     sf::Texture& getTexture(const std::string& name) {
         return textures[name];
     }
     bool hasTexture(const std::string& name) const {
-        return textures.find(name) != textures.end();
+        return atlas.contains(name) || textures.find(name) != textures.end();
+    }
+    // atlas region of a default texture, the whole texture for one loaded with loadTexture()
+    AtlasRegion getRegion(const std::string& name) {
+        if (atlas.contains(name)) {
+            return atlas.getRegion(name);
+        }
+        const sf::Texture& texture = textures[name];
+        return {&texture, sf::IntRect(0, 0, texture.getSize().x, texture.getSize().y)};
     }
     bool loadFont(const std::string& name, const std::string& filename) {
         sf::Font font;
@@ -35,7 +91,7 @@ public:
             std::cerr << "Failed to load font: " << filename << std::endl;
             return false;
         }
-        
+
         fonts[name] = font;
         return true;
     }
@@ -51,7 +107,7 @@ public:
             std::cerr << "Failed to load sound: " << filename << std::endl;
             return false;
         }
-        
+
         sounds[name] = buffer;
         return true;
     }
@@ -61,23 +117,224 @@ public:
     bool hasSound(const std::string& name) const {
         return sounds.find(name) != sounds.end();
     }
+
+    // Decodes the default assets on a pool of worker threads and returns at
+    // once. The caller keeps rendering and calls update() every frame until
+    // it returns true; the font is queued first so text shows up early.
+    // Assets found in the archive are read from its mapping, the others
+    // from their loose file.
+    void startLoading(unsigned workerCount = std::thread::hardware_concurrency(),
+                      const std::string& archivePath = AssetPack::DEFAULT_PATH) {
+        bool packed = archive.open(archivePath);
+        for (const auto& source : defaultAssets()) {
+            const AssetPack::Entry* entry = packed ? archive.find(source.name, source.kind) : nullptr;
+            jobs.push_back({source.kind, source.name, entry ? archivePath + ":" + source.name : source.filename, entry});
+        }
+        pending = jobs.size();
+        loadStart = std::chrono::steady_clock::now();
+        workerCount = std::max(1u, std::min<unsigned>(workerCount, jobs.size()));
+        for (unsigned i = 0; i < workerCount; i++) {
+            workers.emplace_back(&AssetManager::decodeJobs, this);
+        }
+    }
+    // render thread only: stores every finished asset, returns true once
+    // nothing is left to load; the sheets go into the atlas at the end
+    bool update() {
+        std::vector<std::unique_ptr<Decoded>> ready;
+        {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            ready.swap(done);
+        }
+        for (auto& decoded : ready) {
+            auto start = std::chrono::steady_clock::now();
+            const Job& job = jobs[decoded->job];
+            bool loaded = decoded->loaded;
+            if (loaded && job.kind == AssetPack::Kind::TEXTURE) {
+                sheets.push_back(std::move(decoded));
+                pending--;
+                continue;
+            }
+            if (loaded) {
+                switch (job.kind) {
+                    case AssetPack::Kind::TEXTURE:
+                        // kept in sheets above
+                        break;
+                    case AssetPack::Kind::SOUND:
+                        sounds[job.name] = decoded->sound;
+                        break;
+                    case AssetPack::Kind::FONT:
+                        fonts[job.name] = decoded->font;
+                        break;
+                }
+            }
+            if (!loaded) {
+                std::cerr << "Failed to load " << job.filename << std::endl;
+                failed = true;
+            }
+            timings.push_back({job.name, job.filename, decoded->decodeMs, msSince(start), loaded});
+            pending--;
+        }
+        if (pending == 0 && totalMs < 0) {
+            buildAtlas();
+            totalMs = msSince(loadStart);
+        }
+        return pending == 0;
+    }
+    // true if every asset of startLoading() made it
+    bool allLoaded() const {
+        return pending == 0 && !failed;
+    }
+    void printTimings(std::ostream& out) const {
+        out << "[CLIENT] Assets ready in " << std::fixed << std::setprecision(1) << totalMs << " ms on "
+            << workers.size() << " workers, " << atlas.getPageCount() << " atlas pages" << std::endl;
+        for (const auto& timing : timings) {
+            out << "[CLIENT]   " << std::left << std::setw(14) << timing.name << std::setw(36) << timing.filename
+                << "decode " << std::setw(8) << timing.decodeMs << "main " << std::setw(8) << timing.mainMs
+                << (timing.loaded ? "" : "FAILED") << std::endl;
+        }
+    }
+    // blocking version of startLoading() + update()
     bool loadDefaultAssets() {
-        bool success = true;
-        success &= loadTexture("player", "assets/player_sprite_sheet.png");
-        success &= loadTexture("coin", "assets/coins_sprite_sheet.png");
-        success &= loadTexture("electric", "assets/zapper_sprite_sheet.png");
-        success &= loadTexture("background", "assets/background.png");
-        success &= loadFont("main", "assets/jetpack_font.ttf");
-        success &= loadSound("jump", "assets/jetpack_start.wav");
-        success &= loadSound("coin", "assets/coin_pickup_1.wav");
-        success &= loadSound("death", "assets/dud_zapper_pop.wav");
-        success &= loadSound("jetpack", "assets/jetpack_lp.wav");
-        success &= loadSound("jetpack_stop", "assets/jetpack_stop.wav");
-        
-        return success;
+        startLoading();
+        while (!update()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return allLoaded();
     }
 private:
+    struct Job {
+        AssetPack::Kind kind;
+        std::string name;
+        std::string filename;
+        // null when loaded from the loose file
+        const AssetPack::Entry* entry;
+    };
+    // one slot per kind, only the one of the job kind is filled
+    struct Decoded {
+        size_t job;
+        bool loaded;
+        double decodeMs;
+        sf::Image image;
+        sf::SoundBuffer sound;
+        sf::Font font;
+    };
+
+    static double msSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // raw RGBA entries go from the mapping to the GPU without an sf::Image
+    const sf::Uint8* sheetPixels(const Decoded& sheet, sf::Vector2u& size) const {
+        const AssetPack::Entry* entry = jobs[sheet.job].entry;
+        if (entry && entry->encoding == AssetPack::Encoding::RGBA) {
+            size = sf::Vector2u(entry->width, entry->height);
+            return entry->data;
+        }
+        size = sheet.image.getSize();
+        return sheet.image.getPixelsPtr();
+    }
+
+    // packs every decoded sheet into the atlas pages, each upload is timed
+    // as the render thread part of its texture
+    void buildAtlas() {
+        std::vector<std::pair<std::string, sf::Vector2u>> layout;
+        for (const auto& sheet : sheets) {
+            sf::Vector2u size;
+            sheetPixels(*sheet, size);
+            layout.emplace_back(jobs[sheet->job].name, size);
+        }
+        bool placed = atlas.layout(layout, sf::Texture::getMaximumSize());
+        for (const auto& sheet : sheets) {
+            auto start = std::chrono::steady_clock::now();
+            const Job& job = jobs[sheet->job];
+            sf::Vector2u size;
+            const sf::Uint8* pixels = sheetPixels(*sheet, size);
+            if (placed) {
+                atlas.upload(job.name, pixels);
+            } else {
+                std::cerr << "Failed to fit " << job.filename << " in the texture atlas" << std::endl;
+                failed = true;
+            }
+            timings.push_back({job.name, job.filename, sheet->decodeMs, msSince(start), placed});
+        }
+        if (!placed) {
+            atlas.clear();
+        }
+        sheets.clear();
+    }
+
+    // archive entries are decoded in place from the mapping
+    bool decodePacked(const AssetPack::Entry& entry, Decoded& decoded) const {
+        switch (entry.encoding) {
+            case AssetPack::Encoding::RGBA:
+                // nothing to decode, only fault the pages in for the upload
+                archive.prefetch(entry);
+                return entry.kind == AssetPack::Kind::TEXTURE;
+            case AssetPack::Encoding::PCM:
+                return entry.kind == AssetPack::Kind::SOUND && entry.channels > 0
+                    && decoded.sound.loadFromSamples(reinterpret_cast<const sf::Int16*>(entry.data),
+                                                     entry.size / sizeof(sf::Int16), entry.channels, entry.sampleRate);
+            case AssetPack::Encoding::FILE:
+                break;
+        }
+        switch (entry.kind) {
+            case AssetPack::Kind::TEXTURE:
+                return decoded.image.loadFromMemory(entry.data, entry.size);
+            case AssetPack::Kind::SOUND:
+                return decoded.sound.loadFromMemory(entry.data, entry.size);
+            case AssetPack::Kind::FONT:
+                // sf::Font keeps reading the memory, the archive stays mapped
+                return decoded.font.loadFromMemory(entry.data, entry.size);
+        }
+        return false;
+    }
+
+    // worker thread: CPU side decoding only, no GL call here
+    void decodeJobs() {
+        for (size_t index = nextJob++; index < jobs.size(); index = nextJob++) {
+            const Job& job = jobs[index];
+            auto decoded = std::make_unique<Decoded>();
+            auto start = std::chrono::steady_clock::now();
+            decoded->job = index;
+            if (job.entry) {
+                decoded->loaded = decodePacked(*job.entry, *decoded);
+            } else {
+                switch (job.kind) {
+                    case AssetPack::Kind::TEXTURE:
+                        decoded->loaded = decoded->image.loadFromFile(job.filename);
+                        break;
+                    case AssetPack::Kind::SOUND:
+                        decoded->loaded = decoded->sound.loadFromFile(job.filename);
+                        break;
+                    case AssetPack::Kind::FONT:
+                        decoded->loaded = decoded->font.loadFromFile(job.filename);
+                        break;
+                }
+            }
+            decoded->decodeMs = msSince(start);
+            std::lock_guard<std::mutex> lock(doneMutex);
+            done.push_back(std::move(decoded));
+        }
+    }
+
+    // declared first so it is unmapped last, fonts read from it
+    AssetPack::Archive archive;
     std::map<std::string, sf::Texture> textures;
     std::map<std::string, sf::Font> fonts;
     std::map<std::string, sf::SoundBuffer> sounds;
-};
\ No newline at end of file
+
+    // jobs is written before the workers start and only read afterwards
+    std::vector<Job> jobs;
+    std::atomic<size_t> nextJob;
+    std::vector<std::thread> workers;
+    std::mutex doneMutex;
+    std::vector<std::unique_ptr<Decoded>> done;
+    // decoded sheets waiting for the atlas
+    std::vector<std::unique_ptr<Decoded>> sheets;
+    TextureAtlas atlas;
+    size_t pending;
+    bool failed;
+    std::vector<Timing> timings;
+    std::chrono::steady_clock::time_point loadStart;
+    double totalMs = -1.0;
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Asset archive, written by jetpack_pack and mapped by the client:
+//   "JPAK" | u16 version | u16 entry count | entries | blobs
+// entry: name[32] (zero padded) | u8 kind | u8 encoding | u16 channels
+//        | u32 width | u32 height | u32 sample rate | u64 offset | u64 size
+// Every blob starts on BLOB_ALIGN bytes from the file start so pixels and
+// samples can be handed to the GPU / audio device straight from the
+// mapping. Integers are little endian.
+namespace AssetPack {
+    const char MAGIC[4] = {'J', 'P', 'A', 'K'};
+    const uint16_t VERSION = 1;
+    const size_t HEADER_SIZE = 8;
+    const size_t ENTRY_SIZE = 64;
+    const size_t NAME_SIZE = 32;
+    const size_t BLOB_ALIGN = 64;
+    // where the client looks for it, loose files are the fallback
+    const char DEFAULT_PATH[] = "assets/assets.pak";
+
+    enum class Kind : uint8_t { TEXTURE, SOUND, FONT };
+    enum class Encoding : uint8_t {
+        FILE,   // the original file bytes, decoded with loadFromMemory
+        RGBA,   // width * height 8-bit RGBA pixels
+        PCM     // 16-bit interleaved samples
+    };
+
+    struct Entry {
+        std::string name;
+        Kind kind;
+        Encoding encoding;
+        uint16_t channels;
+        uint32_t width;
+        uint32_t height;
+        uint32_t sampleRate;
+        // into the mapping for a read archive, unused when building one
+        const uint8_t* data;
+        size_t size;
+    };
+
+    // read-only mapping of an archive, entries point into it and stay
+    // valid until the archive is closed or destroyed
+    class Archive {
+        public:
+            Archive() : _mapping(nullptr), _mappingSize(0) {}
+            ~Archive();
+            Archive(const Archive&) = delete;
+            Archive& operator=(const Archive&) = delete;
+
+            // returns false if the file is missing or not a valid archive
+            bool open(const std::string& path);
+            void close();
+            bool isOpen() const { return _mapping != nullptr; }
+            const Entry* find(const std::string& name, Kind kind) const;
+            const std::vector<Entry>& getEntries() const { return _entries; }
+            // asks the kernel to read the entry pages ahead of their first use
+            void prefetch(const Entry& entry) const;
+        private:
+            void* _mapping;
+            size_t _mappingSize;
+            std::vector<Entry> _entries;
+    };
+
+    // header, table of contents and aligned blobs; blobs[i] holds the bytes of entries[i]
+    std::vector<uint8_t> build(const std::vector<Entry>& entries, const std::vector<std::vector<uint8_t>>& blobs);
+};
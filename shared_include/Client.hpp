@@ -1,6 +1,10 @@
 #pragma once
 #include "Packet.hpp"
+#include "MapFormat.hpp"
+#include "Protocol.hpp"
+#include "SharedGame.hpp"
 #include <mutex>
+#include <atomic>
 #include <string>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -36,18 +40,45 @@ namespace ClientModule {
             void networkThread();
             void startThread();
             void runThread();
-            std::mutex _packetMutex;
        private:
             std::thread _gameThread;
             std::thread _networkThread;
             void parseArguments(int argc, const char *argv[]);
+            int receiveRawPacket(PacketModule& incomingPacket);
+            int receiveFrames(PacketModule& incomingPacket);
+            void applyIncomingPacket(PacketModule& incomingPacket);
+            int sendUpdate(PacketModule& outgoingPacket);
+            // returns true if the input changed something the next update sends
+            bool applyLocalInput();
+            // game thread: the local input changed, the network thread sends it
+            void wakeNetworkThread();
+            // latest server state with the local input applied, network thread only
             PacketModule packet;
+            LocalInput localInput;
+            // newest stamped input already sent to the server
+            uint16_t sentInputSeq;
+            SharedGameState sharedState;
+            // map chunks received and not yet taken by the game thread
+            std::mutex _chunkMutex;
+            std::vector<MapFormat::MapChunk> mapChunks;
+            Protocol::MapReceiver mapReceiver;
+            std::vector<MapFormat::MapChunk> receivedChunks;
+            // Packet bytes copied between the threads, reported per frame in debug mode
+            std::atomic<uint64_t> copiedBytes;
             int fd;
+            // eventfd the network thread polls next to the socket
+            int wakeFd;
             int id;
             int serverPort;
             std::string serverIp;
             sockaddr_in address;
             bool connected;
             bool debugMode;
+            // legacy full Packet structs instead of framed snapshots (-r)
+            bool rawMode;
+            Protocol::FrameReader stream;
+            Protocol::FrameWriter output;
+            Protocol::SnapshotDecoder decoder;
+            std::vector<uint8_t> inputBuffer;
     };
 };
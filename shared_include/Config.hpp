@@ -5,11 +5,25 @@ struct ServerConfig {
     int port = 4242;
     std::string map_file;
     bool debug_mode = false;
+    int workers = 0; // 0 = one per core
+    int room_size = 2;
+    int tick_rate = 60;
+    bool raw_packets = false; // legacy full Packet structs instead of snapshots
+    // ms a client may stay behind before it is marked slow, degraded, evicted
+    int slow_mark_ms = 250;
+    int slow_degrade_ms = 1000;
+    int slow_evict_ms = 5000;
+#ifdef __linux__
+    std::string backend = "epoll";
+#else
+    std::string backend = "poll";
+#endif
     
     void parseArgs(int argc, char* argv[]);
     void validate() const;
-    void loadMap() const;
     private:
         static int parsePort(const std::string& port_str);
+        static int parseCount(const std::string& value, int min, int max, const std::string& what);
+        void parseSlowLimits(const std::string& value);
         static void printUsage(const std::string& program_name);
 };
\ No newline at end of file
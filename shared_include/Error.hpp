@@ -4,7 +4,6 @@
 #define MAX_CLIENTS 10
 #define FUNC_ERROR -1
 #define SUCCESS 0
-#define MAP_SIZE 1000
 #include <exception>
 #include <string>
 
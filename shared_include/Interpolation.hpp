@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+
+// Remote players are drawn a little in the past, between two snapshots
+// instead of at the newest one, so uneven arrivals do not show as stutter.
+// Times are in seconds: server time comes from the snapshot timestamps,
+// local time from the receiving clock.
+namespace Interpolation {
+    // Picks the server time to draw at. The delay covers one snapshot
+    // interval plus the measured arrival jitter, and moves toward its target
+    // by speeding playback up or slowing it down a little, never by jumping.
+    class PlayoutClock {
+        public:
+            PlayoutClock();
+            void reset();
+            // a snapshot stamped serverTime arrived at local time arrival
+            void observe(double serverTime, double arrival);
+            // advances the delay toward its target, once per frame
+            void update(double now);
+            // server time to draw at local time now
+            double renderTime(double now) const { return now - _offset - _delay; }
+            bool isStarted() const { return _started; }
+            double getDelay() const { return _delay; }
+            double getJitter() const { return _jitter; }
+        private:
+            bool _started;
+            // smallest arrival - serverTime seen, allowed to creep up so a
+            // server falling behind its clock is followed
+            double _offset;
+            double _jitter;
+            double _interval;
+            double _delay;
+            double _lastServerTime;
+            double _lastArrival;
+            double _lastUpdate;
+    };
+
+    // The last snapshots of one remote entity.
+    class EntityHistory {
+        public:
+            static constexpr size_t SIZE = 32;
+            // how far past the newest snapshot the motion is continued
+            static constexpr double MAX_EXTRAPOLATION = 0.1;
+
+            EntityHistory() : _count(0), _next(0) {}
+            void clear() { _count = 0; }
+            // older or repeated times are ignored
+            void push(double time, float x, float y);
+            // position at time; false with no snapshot at all. Before the
+            // oldest snapshot it holds that one, after the newest it goes
+            // on at the last velocity for MAX_EXTRAPOLATION and then holds.
+            bool sample(double time, float& x, float& y, bool* extrapolated = nullptr) const;
+        private:
+            struct Sample {
+                double time;
+                float x;
+                float y;
+            };
+            const Sample& at(size_t age) const { return _samples[(_next + SIZE - 1 - age) % SIZE]; }
+            Sample _samples[SIZE];
+            size_t _count;
+            size_t _next;
+    };
+};
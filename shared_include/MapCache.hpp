@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include "MapFormat.hpp"
+
+// The server map, read once and shared read-only by every room. Binary
+// maps (jetpack_mapc) are used as read, text maps are parsed and packed at
+// load time; either way a version owns its bytes, so rewriting the file in
+// place never touches the rooms playing on it.
+// When inotify reports the file changed, a new version is loaded on a
+// helper thread and the event loop swaps it in once it is ready; rooms
+// keep the version they were created with until they are closed.
+class MapCache {
+    public:
+        struct Map {
+            Map() = default;
+            // tiles points into packed
+            Map(const Map&) = delete;
+            Map& operator=(const Map&) = delete;
+
+            uint32_t version = 0;
+            MapFormat::PackedMap tiles;
+            std::vector<uint8_t> packed;
+        };
+
+        // loads the first version, throws if the file cannot be read or parsed
+        explicit MapCache(const std::string& path);
+        ~MapCache();
+        MapCache(const MapCache&) = delete;
+        MapCache& operator=(const MapCache&) = delete;
+
+        std::shared_ptr<const Map> get() const;
+        // inotify fd to register in the poller, -1 without hot reload
+        int getFd() const { return _inotifyFd; }
+        // drains the pending inotify events, returns true if the map file changed
+        bool handleEvents();
+        // starts loading a new version on the helper thread, a change seen
+        // during a load is loaded again once it is done
+        void startReload();
+        // swaps in a finished load, returns false while none is finished;
+        // error is set if the load failed and the current version stays
+        bool finishReload(std::string& error);
+    private:
+        std::shared_ptr<const Map> load(uint32_t version) const;
+
+        std::string _path;
+        std::string _fileName;
+        int _inotifyFd;
+        std::shared_ptr<const Map> _current;
+        // the helper thread's result, read once _loadDone is set
+        std::thread _loader;
+        std::atomic<bool> _loadDone;
+        bool _loading;
+        bool _reloadAgain;
+        std::shared_ptr<const Map> _loaded;
+        std::string _loadError;
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "MapParser.hpp"
+
+// Binary level format, written by jetpack_mapc and read in place:
+//   "JPMP" | u16 version | u16 bits per tile | u32 width | u32 height | tiles
+// Tiles are stored column after column (tile (x, y) is number x * height + y)
+// so a range of columns is one contiguous slice, two 4-bit tiles per byte,
+// low nibble first. Integers are little endian.
+namespace MapFormat {
+    const char MAGIC[4] = {'J', 'P', 'M', 'P'};
+    const uint16_t VERSION = 1;
+    const uint16_t BITS_PER_TILE = 4;
+    const size_t HEADER_SIZE = 16;
+    // levels are streamed by chunks of columns, an even count keeps each
+    // chunk starting on a byte
+    const int CHUNK_COLUMNS = 16;
+
+    // view over a binary map owned by someone else (a file mapping or a
+    // buffer), reading a tile is a shift and a mask
+    class PackedMap {
+        public:
+            PackedMap() : width(0), height(0), _tiles(nullptr) {}
+            // headerless tiles, e.g. a streamed chunk
+            PackedMap(const uint8_t* tiles, int w, int h) : width(w), height(h), _tiles(tiles) {}
+            // returns false if data does not hold a whole binary map
+            bool open(const uint8_t* data, size_t size);
+            TileType getTile(int x, int y) const {
+                if (x < 0 || x >= width || y < 0 || y >= height) {
+                    return TileType::WALL;
+                }
+                size_t index = static_cast<size_t>(x) * height + y;
+                return static_cast<TileType>((_tiles[index / 2] >> (index % 2 * BITS_PER_TILE)) & 0xF);
+            }
+            int getChunkCount() const { return (width + CHUNK_COLUMNS - 1) / CHUNK_COLUMNS; }
+            // packed tiles of columns [index * CHUNK_COLUMNS, +columns)
+            const uint8_t* getChunk(int index, int& columns, size_t& size) const;
+            int width;
+            int height;
+        private:
+            const uint8_t* _tiles;
+    };
+
+    bool isBinary(const uint8_t* data, size_t size);
+    // header plus packed tiles
+    size_t encodedSize(int width, int height);
+    std::vector<uint8_t> pack(const GameMap& map);
+    GameMap unpack(const PackedMap& map);
+
+    // columns [firstColumn, firstColumn + tiles.width) of a streamed level
+    struct MapChunk {
+        int firstColumn;
+        GameMap tiles;
+    };
+};
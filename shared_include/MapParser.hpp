@@ -6,8 +6,12 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <new>
 
-enum class TileType {
+enum class TileType : uint8_t {
     EMPTY = 0,
     WALL,
     COIN,
@@ -15,16 +19,95 @@ enum class TileType {
     END_MARKER
 };
 
+// std::allocator with a stronger alignment, for buffers read with vector loads
+template <typename T, size_t Align>
+struct AlignedAllocator {
+    using value_type = T;
+    template <typename U> struct rebind { using other = AlignedAllocator<U, Align>; };
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+    }
+    void deallocate(T* p, size_t) {
+        ::operator delete(p, std::align_val_t(Align));
+    }
+    template <typename U> bool operator==(const AlignedAllocator<U, Align>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Align>&) const { return false; }
+};
+
+// One byte per tile, row after row. Rows are padded with EMPTY tiles to a
+// multiple of ROW_ALIGN bytes and the buffer is ROW_ALIGN aligned, so the
+// scanning kernels (MapScan.hpp) only do aligned loads inside a row.
 struct GameMap {
-    int width;
-    int height;
-    std::vector<std::vector<TileType>> tiles;
+    static const size_t ROW_ALIGN = 32;
+
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;
+    std::vector<uint8_t, AlignedAllocator<uint8_t, ROW_ALIGN>> cells;
+
+    // every tile EMPTY
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        stride = (static_cast<size_t>(w) + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+        cells.assign(stride * h, static_cast<uint8_t>(TileType::EMPTY));
+    }
+    const uint8_t* row(int y) const { return cells.data() + static_cast<size_t>(y) * stride; }
     TileType getTile(int x, int y) const {
         if (x >= 0 && x < width && y >= 0 && y < height) {
-            return tiles[y][x];
+            return static_cast<TileType>(row(y)[x]);
         }
         return TileType::WALL;
     }
+    void setTile(int x, int y, TileType tile) {
+        cells[static_cast<size_t>(y) * stride + x] = static_cast<uint8_t>(tile);
+    }
+    static TileType tileFromChar(char c) {
+        switch (c) {
+            case '#':
+                return TileType::WALL;
+            case 'c':
+            case 'C':
+                return TileType::COIN;
+            case 'e':
+            case 'E':
+                return TileType::ELECTRIC;
+            case 'f':
+            case 'F':
+                return TileType::END_MARKER;
+            case '.':
+            case '_':
+            default:
+                return TileType::EMPTY;
+        }
+    }
+    // "<width> <height>" first line of the headed format
+    static bool isHeader(const std::string& line, int& width, int& height) {
+        std::istringstream iss(line);
+        std::string rest;
+        return (iss >> width >> height) && !(iss >> rest);
+    }
+    // headerless format (assets/*.map): one line per row, size taken from the rows
+    static GameMap fromRows(const std::vector<std::string>& rows) {
+        GameMap map;
+        map.height = static_cast<int>(rows.size());
+        map.width = 0;
+        for (const auto& row : rows) {
+            map.width = std::max(map.width, static_cast<int>(row.length()));
+        }
+        if (map.width <= 0 || map.height <= 0) {
+            throw std::runtime_error("Invalid map dimensions");
+        }
+        map.resize(map.width, map.height);
+        for (int y = 0; y < map.height; ++y) {
+            for (size_t x = 0; x < rows[y].length(); ++x) {
+                map.setTile(x, y, tileFromChar(rows[y][x]));
+            }
+        }
+        return map;
+    }
     static GameMap loadFromFile(const std::string& filename) {
         GameMap map;
         std::ifstream file(filename);
@@ -35,13 +118,17 @@ struct GameMap {
         std::string line;
         int lineNum = 0;
         if (std::getline(file, line)) {
-            std::istringstream iss(line);
-            iss >> map.width >> map.height;
-            
+            if (!isHeader(line, map.width, map.height)) {
+                std::vector<std::string> rows{line};
+                while (std::getline(file, line)) {
+                    rows.push_back(line);
+                }
+                return fromRows(rows);
+            }
             if (map.width <= 0 || map.height <= 0) {
                 throw std::runtime_error("Invalid map dimensions");
             }
-            map.tiles.resize(map.height, std::vector<TileType>(map.width, TileType::EMPTY));
+            map.resize(map.width, map.height);
         } else {
             throw std::runtime_error("Invalid map file format");
         }
@@ -51,25 +138,7 @@ struct GameMap {
             }
             
             for (int x = 0; x < map.width; ++x) {
-                char c = line[x];
-                switch (c) {
-                    case '#':
-                        map.tiles[lineNum][x] = TileType::WALL;
-                        break;
-                    case 'c':
-                        map.tiles[lineNum][x] = TileType::COIN;
-                        break;
-                    case 'e':
-                        map.tiles[lineNum][x] = TileType::ELECTRIC;
-                        break;
-                    case 'f':
-                        map.tiles[lineNum][x] = TileType::END_MARKER;
-                        break;
-                    case '.':
-                    default:
-                        map.tiles[lineNum][x] = TileType::EMPTY;
-                        break;
-                }
+                map.setTile(x, lineNum, tileFromChar(line[x]));
             }
             
             lineNum++;
@@ -86,7 +155,7 @@ struct GameMap {
         oss << width << " " << height << "\n";
         for (int y = 0; y < height; ++y) {
             for (int x = 0; x < width; ++x) {
-                switch (tiles[y][x]) {
+                switch (getTile(x, y)) {
                     case TileType::WALL:
                         oss << '#';
                         break;
@@ -97,7 +166,7 @@ struct GameMap {
                         oss << 'e';
                         break;
                     case TileType::END_MARKER:
-                        oss << 'c';
+                        oss << 'f';
                         break;
                     case TileType::EMPTY:
                     default:
@@ -115,13 +184,17 @@ struct GameMap {
         std::string line;
         
         if (std::getline(iss, line)) {
-            std::istringstream dimStream(line);
-            dimStream >> map.width >> map.height;
-            
+            if (!isHeader(line, map.width, map.height)) {
+                std::vector<std::string> rows{line};
+                while (std::getline(iss, line)) {
+                    rows.push_back(line);
+                }
+                return fromRows(rows);
+            }
             if (map.width <= 0 || map.height <= 0) {
                 throw std::runtime_error("Invalid map dimensions");
             }
-            map.tiles.resize(map.height, std::vector<TileType>(map.width, TileType::EMPTY));
+            map.resize(map.width, map.height);
         } else {
             throw std::runtime_error("Invalid map data format");
         }
@@ -131,38 +204,13 @@ struct GameMap {
                 line.append(map.width - line.length(), '.');
             }
             
+            // missing rows stay EMPTY
             for (int x = 0; x < map.width; ++x) {
-                if (x < static_cast<int>(line.length())) {
-                    char c = line[x];
-                    switch (c) {
-                        case '#':
-                            map.tiles[lineNum][x] = TileType::WALL;
-                            break;
-                        case 'c':
-                            map.tiles[lineNum][x] = TileType::COIN;
-                            break;
-                        case 'e':
-                            map.tiles[lineNum][x] = TileType::ELECTRIC;
-                            break;
-                        case 'f':
-                            map.tiles[lineNum][x] = TileType::END_MARKER;
-                            break;
-                        case '.':
-                        default:
-                            map.tiles[lineNum][x] = TileType::EMPTY;
-                            break;
-                    }
-                } else {
-                    map.tiles[lineNum][x] = TileType::EMPTY;
-                }
+                map.setTile(x, lineNum, tileFromChar(line[x]));
             }
             
             lineNum++;
         }
-        while (lineNum < map.height) {
-            map.tiles[lineNum].assign(map.width, TileType::EMPTY);
-            lineNum++;
-        }
         
         return map;
     }
@@ -172,26 +220,24 @@ class MapGenerator {
 public:
     static GameMap generateTestMap(int width, int height) {
         GameMap map;
-        map.width = width;
-        map.height = height;
-        map.tiles.resize(height, std::vector<TileType>(width, TileType::EMPTY));
+        map.resize(width, height);
         
         for (int x = 0; x < width; ++x) {
-            map.tiles[0][x] = TileType::WALL;
-            map.tiles[height - 1][x] = TileType::WALL;
+            map.setTile(x, 0, TileType::WALL);
+            map.setTile(x, height - 1, TileType::WALL);
         }
         for (int x = 5; x < width; x += 7) {
             for (int y = 3; y < height - 3; y += 5) {
-                map.tiles[y][x] = TileType::COIN;
+                map.setTile(x, y, TileType::COIN);
             }
         }
         for (int x = 10; x < width; x += 15) {
             for (int y = 5; y < height - 5; y += 8) {
-                map.tiles[y][x] = TileType::ELECTRIC;
+                map.setTile(x, y, TileType::ELECTRIC);
             }
         }
         if (width > 10) {
-            map.tiles[height / 2][width - 5] = TileType::END_MARKER;
+            map.setTile(width - 5, height / 2, TileType::END_MARKER);
         }
         return map;
     }
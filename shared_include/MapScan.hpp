@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "MapParser.hpp"
+
+// Vectorized tile search over the GameMap tile buffer. The kernel compares
+// aligned 32-tile blocks of a row at once; the implementation is picked at
+// run time from what the CPU supports (AVX2, then SSE2, then plain loops),
+// so the build needs no -m flags.
+namespace MapScan {
+    enum class Level {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    struct Cell {
+        int x;
+        int y;
+        TileType type;
+    };
+
+    // best level this CPU runs
+    Level detect();
+    Level getLevel();
+    // for benchmarks, levels above detect() are lowered to it
+    void setLevel(Level level);
+    const char *name(Level level);
+
+    // appends the tiles of type a or b in columns [firstColumn, lastColumn),
+    // row after row and left to right
+    void findTiles(const GameMap& map, TileType a, TileType b, int firstColumn, int lastColumn, std::vector<Cell>& out);
+};
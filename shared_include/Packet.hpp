@@ -12,6 +12,7 @@ class PacketModule {
         PacketModule();
         PacketModule(int nb_clients);
         PacketModule(const PacketModule& other);
+        PacketModule& operator=(const PacketModule& other) = default;
         ~PacketModule();
 
         enum gameState {
@@ -25,18 +26,22 @@ class PacketModule {
                 if (this != &other) {
                     nb_client = other.nb_client;
                     client_id = other.client_id;
+                    jetpack = other.jetpack;
                     for (int i = 0; i < MAX_CLIENTS; ++i) {
                         playerState[i] = other.playerState[i];
                         playerPosition[i] = other.playerPosition[i];
+                        playerScore[i] = other.playerScore[i];
                     }
                 }
                 return *this;
             }
             int nb_client;
             int client_id;
-            char map[MAP_SIZE];
             gameState playerState[MAX_CLIENTS];
             std::pair<int, int> playerPosition[MAX_CLIENTS];
+            int playerScore[MAX_CLIENTS];
+            // client input, the server simulates positions from it
+            bool jetpack;
         };
         void display(std::string info);
         void setPacket(const struct Packet& pkt);
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+// Readiness notification backend used by the server event loop.
+// Fds are registered once and stay registered until removed, so a wakeup
+// only costs what the backend needs to find the ready sockets.
+class Poller {
+    public:
+        virtual ~Poller() = default;
+        virtual void add(int fd) = 0;
+        virtual void remove(int fd) = 0;
+        // fills ready with the fds that have pending input (or hang up),
+        // returns the number of ready fds or -1 on error (errno is set)
+        virtual int wait(std::vector<int>& ready, int timeout_ms) = 0;
+        virtual const char *name() const = 0;
+
+        static std::unique_ptr<Poller> create(const std::string& backend);
+};
+
+// portable fallback, scans every registered fd on each wakeup
+class PollPoller : public Poller {
+    public:
+        void add(int fd) override;
+        void remove(int fd) override;
+        int wait(std::vector<int>& ready, int timeout_ms) override;
+        const char *name() const override { return "poll"; }
+    private:
+        std::vector<pollfd> _fds;
+        std::unordered_map<int, size_t> _index;
+};
+
+#ifdef __linux__
+// edge-triggered epoll, callers must drain a fd until EAGAIN once it is reported
+class EpollPoller : public Poller {
+    public:
+        EpollPoller();
+        ~EpollPoller();
+        void add(int fd) override;
+        void remove(int fd) override;
+        int wait(std::vector<int>& ready, int timeout_ms) override;
+        const char *name() const override { return "epoll"; }
+    private:
+        int _epollFd;
+        std::vector<epoll_event> _events;
+};
+#endif
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include "Simulation.hpp"
+#include "Protocol.hpp"
+
+// Client-side prediction with server reconciliation. The client samples
+// its input once per simulation step and stamps it with a sequence number;
+// the server runs exactly one input per step and sends back, with every
+// snapshot, the last input it used and the state that left the player in.
+// The client restarts from that state and replays the inputs the server
+// has not used yet, so a right guess is never moved and a wrong one is
+// fixed without waiting a round trip.
+namespace Prediction {
+    // seq a is newer than seq b, sequence numbers wrap around
+    inline bool newer(uint16_t a, uint16_t b) { return static_cast<int16_t>(a - b) > 0; }
+
+    // Client side, the local player ahead of the server.
+    class Predictor {
+        public:
+            // inputs kept for replay, a power of two, several round trips of steps
+            static constexpr size_t HISTORY_SIZE = 512;
+
+            explicit Predictor(int stepRate = 60);
+            void setStepRate(int stepRate);
+            // drops the input history, the next input starts from state
+            void reset(const Simulation::PlayerState& state);
+            // runs the steps that fit in elapsed seconds with the current
+            // input, returns the number of steps run
+            int advance(float elapsed, bool jetpack);
+            // restarts from the server state reached after input ackSeq and
+            // replays the newer inputs; returns how far the prediction moved
+            float reconcile(uint16_t ackSeq, const Simulation::PlayerState& server);
+
+            const Simulation::PlayerState& getState() const { return _state; }
+            // between the last two steps, by the time left in the accumulator
+            Simulation::PlayerState getRenderState() const;
+            // newest input and the jetpack bits of the inputs up to it, bit i
+            // being input seq - i, for Protocol::Input
+            uint16_t getSeq() const { return _seq; }
+            uint64_t getJetpackHistory() const { return _jetpackBits; }
+        private:
+            struct Entry {
+                uint16_t seq;
+                bool jetpack;
+                // the state once the input ran
+                Simulation::PlayerState state;
+            };
+            float _step;
+            float _accumulator;
+            Simulation::PlayerState _state;
+            Simulation::PlayerState _previous;
+            uint16_t _seq;
+            uint64_t _jetpackBits;
+            // _entries[seq % HISTORY_SIZE], the last _count inputs
+            Entry _entries[HISTORY_SIZE];
+            size_t _count;
+    };
+
+    // Server side, the stamped inputs of one player waiting for their step.
+    class InputQueue {
+        public:
+            // beyond this many queued steps the oldest are dropped, a client
+            // running ahead must not build up latency
+            static constexpr size_t MAX_QUEUED = 32;
+
+            InputQueue() : _jetpack(false), _stamped(false), _lastSeq(0), _receivedSeq(0) {}
+            // queues the inputs of a message not seen yet, a message without
+            // stamped inputs sets the held jetpack state directly
+            void push(const Protocol::Input& input);
+            // jetpack state for the next step, the last one again if the
+            // client's next input is late
+            bool next();
+            // last input used by a step, 0 before the first one
+            uint16_t getLastSeq() const { return _lastSeq; }
+            size_t size() const { return _queue.size(); }
+        private:
+            std::deque<std::pair<uint16_t, bool>> _queue;
+            bool _jetpack;
+            // a stamped input was received, _receivedSeq is the newest one
+            bool _stamped;
+            uint16_t _lastSeq;
+            uint16_t _receivedSeq;
+    };
+};
@@ -0,0 +1,300 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <deque>
+#include <memory>
+#include <sys/types.h>
+#include "Packet.hpp"
+#include "MapFormat.hpp"
+#include "Simulation.hpp"
+
+// Wire protocol used unless the raw-struct compatibility mode (-r) is on.
+// Every message is framed as [uint16 length][uint8 type][payload], the
+// length counting the type byte and the payload. Multi-byte fields are
+// written byte by byte, little endian, so both ends agree on any host.
+namespace Protocol {
+    const uint8_t VERSION = 4;
+    enum MessageType : uint8_t {
+        SNAPSHOT = 1,   // server -> client, delta-compressed room state
+        INPUT,          // client -> server, jetpack input and snapshot ack
+        MAP_BEGIN,      // server -> client, map size and step rate, starts the map stream
+        MAP_CHUNK,      // server -> client, one chunk of packed map columns
+        MAP_END,        // server -> client, every chunk was sent
+    };
+    const size_t FRAME_HEADER_SIZE = 3;
+    const size_t MAX_FRAME_SIZE = 65535;
+    // MAP_CHUNK header, the chunk index
+    const size_t MAP_CHUNK_HEADER_SIZE = 4;
+
+    // snapshot field quantization, positions are whole pixels
+    const int ID_BITS = 4;
+    const int STATE_BITS = 2;
+    const int X_BITS = 24;
+    const int Y_BITS = 10;
+    const int SCORE_BITS = 16;
+    // snapshots kept per room to serve as delta baselines
+    const size_t HISTORY_SIZE = 32;
+    // stamped inputs one INPUT message can carry
+    const int MAX_INPUT_HISTORY = 64;
+
+    class BitWriter {
+        public:
+            explicit BitWriter(std::vector<uint8_t>& out) : _out(out), _bit(0) {}
+            void write(uint32_t value, int bits);
+        private:
+            std::vector<uint8_t>& _out;
+            int _bit;
+    };
+
+    class BitReader {
+        public:
+            BitReader(const uint8_t* data, size_t size) : _data(data), _size(size), _pos(0) {}
+            // returns false once the buffer is exhausted
+            bool read(uint32_t& value, int bits);
+        private:
+            const uint8_t* _data;
+            size_t _size;
+            size_t _pos;
+    };
+
+    struct EntityState {
+        uint8_t state;
+        int32_t x;
+        int32_t y;
+        int32_t score;
+        bool operator==(const EntityState& other) const {
+            return state == other.state && x == other.x && y == other.y && score == other.score;
+        }
+    };
+
+    struct Snapshot {
+        uint16_t seq;
+        uint8_t clientId;
+        uint8_t nbClient;
+        uint16_t present; // bit i is set while player i is in the room
+        EntityState entities[MAX_CLIENTS];
+
+        Snapshot();
+        void fromPacket(const PacketModule::Packet& pkt, uint16_t sequence);
+        void toPacket(PacketModule::Packet& pkt) const;
+    };
+
+    // The receiving player as the server simulated it, exact and not delta
+    // compressed, with the last stamped input the simulation used.
+    struct PlayerAck {
+        uint16_t inputSeq = 0;
+        Simulation::PlayerState state;
+    };
+
+    // Server side, one per room. The room state is recorded once per
+    // broadcast and its entity body encoded once per baseline in use: every
+    // client that acknowledged the same snapshot shares the same buffer and
+    // only gets its own small header (client id, own player) in front.
+    class SnapshotEncoder {
+        public:
+            using Buffer = std::shared_ptr<const std::vector<uint8_t>>;
+            // SNAPSHOT frame header and per-client fields, the body follows
+            static const size_t CLIENT_HEADER_SIZE = 28;
+
+            SnapshotEncoder();
+            // starts a new snapshot of pkt, whose client_id is ignored; step
+            // is the room simulation step the state was taken at, the client
+            // times the remote players' motion with it
+            void record(const PacketModule::Packet& pkt, uint32_t step);
+            // the entity body of the current snapshot for a client whose
+            // last acknowledged snapshot is ack, 0 for none; baseline is set
+            // to the snapshot it is delta encoded against, 0 for none
+            Buffer body(uint16_t ack, uint16_t& baseline);
+            // same without the cache, into out
+            void encodeBody(uint16_t baseline, std::vector<uint8_t>& out) const;
+            // the frame header and per-client fields, replacing out
+            void encodeHeader(uint8_t clientId, uint16_t baseline, size_t bodySize, const PlayerAck& own,
+                std::vector<uint8_t>& out) const;
+            // the whole frame for one client in one buffer
+            void encodeFrame(uint8_t clientId, uint16_t ack, const PlayerAck& own, std::vector<uint8_t>& out);
+            uint16_t getSeq() const { return _seq; }
+        private:
+            // the acknowledged snapshot while it is still in the history, 0 otherwise
+            uint16_t baselineFor(uint16_t ack) const;
+            Snapshot _history[HISTORY_SIZE];
+            uint16_t _seq;
+            uint32_t _step;
+            // bodies of the current snapshot by baseline, a handful at most
+            std::vector<std::pair<uint16_t, Buffer>> _bodies;
+    };
+
+    // Client side, keeps the decoded snapshots the server may use as baselines.
+    class SnapshotDecoder {
+        public:
+            SnapshotDecoder();
+            // returns false on a malformed snapshot, a version mismatch or an unknown baseline
+            bool decode(const uint8_t* data, size_t size, PacketModule::Packet& pkt);
+            uint16_t getLastSeq() const { return _lastSeq; }
+            // simulation step of the last decoded snapshot
+            uint32_t getStep() const { return _step; }
+            // the own player part of the last decoded snapshot
+            const PlayerAck& getAck() const { return _ack; }
+        private:
+            Snapshot _history[HISTORY_SIZE];
+            bool _valid[HISTORY_SIZE];
+            uint16_t _lastSeq;
+            uint32_t _step;
+            PlayerAck _ack;
+    };
+
+    // Inputs are sampled once per simulation step and numbered. A message
+    // carries the newest one, seq, and the jetpack bits of the count inputs
+    // up to it, bit i being input seq - i. count is 0 for a client that only
+    // sends its held jetpack state.
+    struct Input {
+        uint16_t ack = 0;
+        bool jetpack = false;
+        uint16_t seq = 0;
+        uint8_t count = 0;
+        uint64_t history = 0;
+    };
+    void encodeInput(const Input& input, std::vector<uint8_t>& out);
+    bool decodeInput(const uint8_t* data, size_t size, Input& input);
+
+    // Map stream, whole frames appended to out: MAP_BEGIN (u32 width,
+    // u32 height, u16 chunk columns, u16 simulation steps per second), then MAP_CHUNKs (u32 chunk index,
+    // packed columns) in order, as the player gets close to them, then MAP_END.
+    void encodeMapBegin(const MapFormat::PackedMap& map, int stepRate, std::vector<uint8_t>& out);
+    void encodeMapChunk(const MapFormat::PackedMap& map, int index, std::vector<uint8_t>& out);
+    void encodeMapEnd(std::vector<uint8_t>& out);
+
+    // Client side, decodes the MAP_* frames into chunks of columns.
+    class MapReceiver {
+        public:
+            MapReceiver() : _width(0), _height(0), _chunkColumns(0), _stepRate(0), _nextChunk(0), _started(false), _complete(false) {}
+            // appends a decoded MAP_CHUNK to chunks, returns false on a frame
+            // out of order or a size mismatch
+            bool feed(uint8_t type, const uint8_t* data, size_t size, std::vector<MapFormat::MapChunk>& chunks);
+            bool isStarted() const { return _started; }
+            bool isComplete() const { return _complete; }
+            int getWidth() const { return _width; }
+            int getHeight() const { return _height; }
+            int getStepRate() const { return _stepRate; }
+        private:
+            int _width;
+            int _height;
+            int _chunkColumns;
+            int _stepRate;
+            int _nextChunk;
+            bool _started;
+            bool _complete;
+    };
+
+    // receive buffers: a client takes map chunks up to MAX_FRAME_SIZE, the
+    // server only small inputs, a frame that cannot fit is malformed
+    const size_t CLIENT_READ_BUFFER = 1 << 17;
+    const size_t SERVER_READ_BUFFER = 1 << 12;
+
+    // Per-connection receive side. Everything queued on the socket is read
+    // into a ring buffer with recvmsg over its free space, partial
+    // frames stay there until the rest arrives, and every complete frame is
+    // then handed out in one pass without copying unless it wraps around
+    // the end of the ring.
+    class FrameReader {
+        public:
+            // capacity is rounded up to a power of two
+            explicit FrameReader(size_t capacity = CLIENT_READ_BUFFER);
+            // reads until EAGAIN; returns the number of bytes read, 0 if
+            // nothing was queued and -1 if the connection is closed or
+            // broken; stops early when the buffer is full, see isFull()
+            ssize_t fill(int fd);
+            bool isFull() const { return _tail - _head == _buffer.size(); }
+            // returns 1 with a whole frame, 0 if none is buffered yet and -1
+            // on a malformed frame; payload stays valid until the next fill()
+            int nextFrame(uint8_t& type, const uint8_t*& payload, size_t& size);
+            // unframed bytes, for the raw packet mode
+            bool nextBytes(void* out, size_t size);
+        private:
+            void copyOut(size_t offset, size_t size, uint8_t* out) const;
+            std::vector<uint8_t> _buffer;
+            // frames wrapping around the end of the ring are copied here
+            std::vector<uint8_t> _scratch;
+            // running byte counts, masked on access
+            size_t _head;
+            size_t _tail;
+    };
+
+    // Client send side. Frames are appended and go out together
+    // with one send; what the socket does not take stays queued for the
+    // next flush, so a short write never splits the stream.
+    class FrameWriter {
+        public:
+            FrameWriter() : _sent(0) {}
+            // false if the payload is larger than a frame can carry
+            bool append(uint8_t type, const uint8_t* payload, size_t size);
+            // unframed bytes, for the raw packet mode
+            void appendBytes(const void* data, size_t size);
+            // whole frames may also be encoded here directly, as encodeMap* do
+            std::vector<uint8_t>& getBuffer() { return _buffer; }
+            // returns the number of bytes sent, 0 if the socket is full and
+            // -1 if the connection is broken
+            ssize_t flush(int fd);
+            size_t size() const { return _buffer.size() - _sent; }
+            bool empty() const { return size() == 0; }
+        private:
+            std::vector<uint8_t> _buffer;
+            size_t _sent;
+    };
+
+    // Server side send queue of one connection. Buffers shared with other
+    // connections are queued by reference, small pieces are copied into the
+    // queue, and everything pending goes out with one sendmsg over the
+    // pieces in order. What the socket does not take stays queued for the
+    // next flush. Room states are superseded every tick, so the queue holds
+    // at most one that has not started going out: a newer one overwrites
+    // it. Everything else (map frames) is reliable and always sent.
+    class SendQueue {
+        public:
+            using Buffer = std::shared_ptr<const std::vector<uint8_t>>;
+            // pieces handed to one sendmsg call
+            static const int MAX_IOVECS = 64;
+            // shared buffers smaller than this are copied: one more iovec
+            // costs the kernel more than copying a snapshot body
+            static const size_t MIN_SHARED_SIZE = 1024;
+
+            SendQueue() : _sentInFront(0), _arenaLive(0), _size(0), _lastState(0), _startedState(0) {}
+            void push(const void* data, size_t size) { append(data, size, 0); }
+            void push(const std::vector<uint8_t>& bytes) { push(bytes.data(), bytes.size()); }
+            void push(Buffer buffer) { append(std::move(buffer), 0); }
+            // queues a room state, data then body; returns true if it
+            // overwrote an older state that had not started going out
+            bool pushState(const void* data, size_t size, Buffer body = nullptr);
+            // returns the number of bytes sent, 0 if the socket is full and
+            // -1 if the connection is broken
+            ssize_t flush(int fd);
+            size_t size() const { return _size; }
+            bool empty() const { return _size == 0; }
+        private:
+            struct Segment {
+                // null for bytes copied in _arena
+                Buffer shared;
+                size_t offset;
+                size_t size;
+                // the room state the bytes belong to, 0 for reliable bytes
+                uint32_t state;
+            };
+            const uint8_t* data(const Segment& segment) const;
+            void append(const void* data, size_t size, uint32_t state);
+            void append(Buffer buffer, uint32_t state);
+            void consume(size_t bytes);
+            // moves the copies still queued to a fresh arena once most of it is dead
+            void compact();
+            std::deque<Segment> _segments;
+            std::vector<uint8_t> _arena;
+            // bytes of the front segment already sent
+            size_t _sentInFront;
+            // _arena bytes still referenced by a segment
+            size_t _arenaLive;
+            size_t _size;
+            uint32_t _lastState;
+            // the state partly sent, it cannot be overwritten any more
+            uint32_t _startedState;
+    };
+};
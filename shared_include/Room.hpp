@@ -0,0 +1,148 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include "Packet.hpp"
+#include "Simulation.hpp"
+#include "Protocol.hpp"
+#include "Prediction.hpp"
+#include "MapCache.hpp"
+
+// One match: a map, a fixed number of player slots and the
+// WAITING -> PLAYING -> ENDED state machine. Network reads come from the
+// server event loop, ticks come from a RoomScheduler worker, so every
+// access goes through the room mutex.
+// The room is authoritative: clients only send their jetpack input and
+// every tick runs the fixed-timestep simulation on the parsed map, one
+// input per step, reporting the last input used back to the client.
+// The map is streamed by chunks of columns a little ahead of each player,
+// and the room keeps its map version even if the server reloads the file.
+// A client that cannot keep up only ever has the newest room state
+// waiting for it; one that stays behind gets fewer states, then is dropped.
+class Room {
+    public:
+        struct TickStats {
+            uint64_t ticks = 0;
+            uint64_t totalUs = 0;
+            uint64_t maxUs = 0;
+            uint64_t totalLagUs = 0;
+            uint64_t maxLagUs = 0;
+            // written to the sockets, room states and map frames
+            uint64_t bytesSent = 0;
+            // queued, and overwritten by a newer state before going out
+            uint64_t stateBytesQueued = 0;
+            uint64_t stateBytesReplaced = 0;
+            uint64_t mapBytesQueued = 0;
+            uint64_t evicted = 0;
+        };
+
+        // how long a client may keep unsent bytes queued before it is
+        // marked slow, then gets fewer room states, then is disconnected
+        struct SlowClientLimits {
+            std::chrono::milliseconds mark{250};
+            std::chrono::milliseconds degrade{1000};
+            std::chrono::milliseconds evict{5000};
+        };
+        enum Pace { KEEPING_UP, MARKED, DEGRADED };
+        // per client, counted since the last getClientStats()
+        struct ClientStats {
+            int id;
+            Pace pace;
+            size_t queuedBytes;
+            size_t maxQueuedBytes;
+            // room states overwritten by a newer one before they went out
+            uint64_t dropped;
+            // room states not sent because the client is degraded
+            uint64_t skipped;
+        };
+
+        Room(int id, int capacity, std::shared_ptr<const MapCache::Map> map, int tickRate, bool rawPackets,
+            SlowClientLimits limits);
+
+        int getId() const { return _id; }
+        uint32_t getMapVersion() const { return _map->version; }
+        PacketModule::gameState getState();
+        bool isJoinable();
+        bool isEmpty();
+        size_t getPlayerCount();
+
+        // returns the client id given to the player, or -1 if the room is full
+        int addPlayer(int fd);
+        void removePlayer(int fd);
+        void updatePlayer(int fd, PacketModule& packetModule);
+        void updateInput(int fd, const Protocol::Input& input);
+
+        // runs the simulation steps due since the last tick, advances the
+        // state machine and sends the room state to every player
+        void tick();
+
+        // scheduler bookkeeping
+        std::atomic<bool> queued;
+        std::chrono::steady_clock::time_point scheduledAt;
+        void recordTick(std::chrono::microseconds duration, std::chrono::microseconds lag);
+        TickStats getStats();
+        std::vector<ClientStats> getClientStats();
+    private:
+        struct Player {
+            int fd;
+            int id;
+            Prediction::InputQueue inputs;
+            Simulation::PlayerState state;
+            Simulation::CoinTracker coins;
+            // last snapshot the client acknowledged, its delta baseline
+            uint16_t snapshotAck = 0;
+            // map frames queued so far (MAP_BEGIN, chunks, MAP_END)
+            int mapFrames = 0;
+            // bytes not sent yet, the newest room state replaces an unsent one
+            Protocol::SendQueue output;
+            // the client can use the map, it gets room states from now on
+            bool mapReady = false;
+            // backpressure: the queue has not been empty since behindSince,
+            // or has stayed empty since caughtUpSince
+            Pace pace = KEEPING_UP;
+            bool behind = false;
+            bool evicted = false;
+            std::chrono::steady_clock::time_point behindSince;
+            std::chrono::steady_clock::time_point caughtUpSince;
+            int degradedTurn = 0;
+            size_t maxQueued = 0;
+            uint64_t dropped = 0;
+            uint64_t skipped = 0;
+        };
+        void step();
+        void updateState();
+        void fillPacket(PacketModule::Packet& pkt) const;
+        // records the room state once and queues it for every player ready for it
+        void broadcast();
+        bool sendTo(Player& player, PacketModule::Packet& pkt);
+        // marks, degrades or evicts the player by how long its queue has not drained
+        void updatePace(Player& player, std::chrono::steady_clock::time_point now);
+        bool flush(Player& player);
+        bool streamMap(Player& player);
+
+        int _id;
+        int _capacity;
+        std::shared_ptr<const MapCache::Map> _map;
+        bool _rawPackets;
+        int _stepRate;
+        SlowClientLimits _limits;
+        Protocol::SnapshotEncoder _encoder;
+        std::vector<uint8_t> _headerBuffer;
+        std::vector<uint8_t> _mapBuffer;
+        PacketModule::gameState _state;
+        bool _updated;
+        std::chrono::steady_clock::duration _stepDuration;
+        std::chrono::steady_clock::duration _accumulator;
+        std::chrono::steady_clock::time_point _lastStep;
+        // simulation steps run so far, the snapshot timestamp
+        uint32_t _steps;
+        int _sendEvery;
+        int _ticksSinceSend;
+        std::vector<Player> _players;
+        std::mutex _mutex;
+        TickStats _stats;
+};
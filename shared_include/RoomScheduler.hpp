@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include "Room.hpp"
+
+// Ticks rooms on a pool of worker threads. Every room has a home worker;
+// a worker drains its own queue from the front and, once empty, steals
+// from the back of the other queues so one slow core does not hold back
+// the rooms queued behind it.
+class RoomScheduler {
+    public:
+        explicit RoomScheduler(size_t workers);
+        ~RoomScheduler();
+        void start();
+        void stop();
+        size_t getWorkerCount() const { return _workers.size(); }
+
+        // queues every room whose previous tick already completed
+        void schedule(const std::vector<std::shared_ptr<Room>>& rooms);
+        // number of rooms taken from another worker's queue since the last call
+        std::vector<uint64_t> takeStealCounts();
+    private:
+        struct Worker {
+            std::mutex mutex;
+            std::deque<std::shared_ptr<Room>> queue;
+            std::thread thread;
+            std::atomic<uint64_t> steals{0};
+        };
+        void workerLoop(size_t index);
+        std::shared_ptr<Room> popLocal(size_t index);
+        std::shared_ptr<Room> steal(size_t index);
+
+        std::vector<std::unique_ptr<Worker>> _workers;
+        std::mutex _wakeMutex;
+        std::condition_variable _wake;
+        size_t _pending;
+        bool _running;
+};
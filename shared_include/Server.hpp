@@ -6,8 +6,13 @@
 #include <poll.h>
 #include "Config.hpp"
 #include "Packet.hpp"
-#include <mutex>
+#include "Poller.hpp"
+#include "Room.hpp"
+#include "RoomScheduler.hpp"
+#include "Protocol.hpp"
+#include "MapCache.hpp"
 #include <unordered_map>
+#include <chrono>
 
 class Server {
     public:
@@ -18,20 +23,29 @@ class Server {
     private:
     // server management
         void handleNewConnection();
+        void addClient(int client_fd, const sockaddr_in &client_addr);
         void handleClientData(int client_fd);
         void removeClient(int fd);
+    // rooms handling
+        std::shared_ptr<Room> findRoom();
+        void reloadMap();
+        void installMap();
+        void reportRooms(std::chrono::steady_clock::duration elapsed);
     // packets handling
-        void broadcastPackets();
-        int sendPacket(int client_fd, PacketModule &packetModule);
-        bool readPacket(int client_fd, PacketModule &packetModule);
+        // false on a malformed message
+        bool handleMessages(int client_fd, Protocol::FrameReader& reader, Room& room);
     // local variables
-        bool _packetsUpdated;
         int _serverFd;
-        int _nbClients;
+        int _nextRoomId;
         bool _running;
-        std::mutex _clientsMutex;
-        std::vector<std::shared_ptr<pollfd>> _fdsList;
-        std::unordered_map<int, PacketModule> _packets;
-        std::unordered_map<int, int> _clientIds; 
+        std::unique_ptr<Poller> _poller;
+        std::unique_ptr<RoomScheduler> _scheduler;
+        std::vector<std::shared_ptr<Room>> _rooms;
+        std::unique_ptr<MapCache> _maps;
+        // the client maps are only touched on the event loop thread, rooms
+        // lock their own state for the scheduler workers
+        std::unordered_map<int, std::shared_ptr<Room>> _clientRooms;
+        // receive buffer of every connected client
+        std::unordered_map<int, Protocol::FrameReader> _readers;
         ServerConfig config;
 };
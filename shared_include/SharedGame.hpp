@@ -1,24 +1,96 @@
 #pragma once
 
-#include <shared_mutex>
 #include <atomic>
-#include "Client.hpp"
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include "Packet.hpp"
+#include "Protocol.hpp"
 
 namespace ClientModule {
-class SharedGameState {
-    private:
-        Game _current_state;
-        std::shared_mutex _rw_mutex;
 
+// Single producer / single consumer handoff of the latest value, wait-free
+// on both sides. Three slots: the producer fills its back slot and swaps
+// it with the middle one, the consumer swaps its front slot with the
+// middle one when a newer value is there. Nobody ever waits for the other
+// side and the consumer always sees a complete value, older values the
+// consumer did not pick up are simply overwritten.
+template <typename T>
+class TripleBuffer {
     public:
-        void updateFromNetwork(const Game& new_state) {
-            std::unique_lock lock(_rw_mutex);
-            _current_state = new_state;
-        }
+        TripleBuffer() : _middle(1), _back(0), _front(2) {}
 
-        Game getStateForRendering() {
-            std::shared_lock lock(_rw_mutex);
-            return _current_state;
+        // producer: the slot to fill, then publish() it
+        T& writeBuffer() { return _slots[_back].value; }
+        void publish() {
+            _back = _middle.exchange(_back | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+        // consumer: takes the newest published value if there is one,
+        // returns false if read() is still the latest
+        bool update() {
+            if (!(_middle.load(std::memory_order_relaxed) & FRESH)) {
+                return false;
+            }
+            _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX;
+            return true;
         }
-    };
+        // the consumer owns this slot until its next update()
+        T& read() { return _slots[_front].value; }
+    private:
+        static const uint8_t INDEX = 0x3;
+        static const uint8_t FRESH = 0x4;
+        // one slot per cache line, the two threads never write the same line
+        struct alignas(64) Slot {
+            T value;
+        };
+        Slot _slots[3];
+        // index of the middle slot, FRESH if published and not taken yet
+        alignas(64) std::atomic<uint8_t> _middle;
+        alignas(64) uint8_t _back;
+        alignas(64) uint8_t _front;
+};
+
+// a server update as the game thread gets it
+struct ServerUpdate {
+    PacketModule packet;
+    // the local player as the server simulated it, snapshots only
+    bool hasAck = false;
+    Protocol::PlayerAck ack;
+    // simulation steps per second, 0 until the map stream started
+    int stepRate = 0;
+    // room simulation step the state was taken at, snapshots only
+    uint32_t step = 0;
+    // when the network thread received it
+    std::chrono::steady_clock::time_point arrival;
+};
+
+// what the game thread simulated locally, sent with the next update
+struct LocalInput {
+    std::pair<int, int> position = std::make_pair(0, 0);
+    bool jetpack = false;
+    // a zapper or the end marker was touched this frame
+    bool ended = false;
+    // newest predicted step and the jetpack bits of the steps up to it
+    uint16_t inputSeq = 0;
+    uint64_t inputHistory = 0;
+
+    bool operator==(const LocalInput& other) const {
+        return position == other.position && jetpack == other.jetpack && ended == other.ended
+            && inputSeq == other.inputSeq && inputHistory == other.inputHistory;
+    }
+    bool operator!=(const LocalInput& other) const {
+        return !(*this == other);
+    }
+};
+
+// State shared by the network and game threads, one direction each:
+// server snapshots go to the renderer, local input to the network thread.
+class SharedGameState {
+    public:
+        // written by the network thread, read by the game thread
+        TripleBuffer<ServerUpdate> snapshots;
+        // written by the game thread, read by the network thread
+        TripleBuffer<LocalInput> input;
+};
+
 };
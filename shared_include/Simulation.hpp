@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include "MapFormat.hpp"
+
+// Gameplay rules shared by the server simulation and the client.
+// Speeds are per second so a step gives the same result at any rate.
+namespace Simulation {
+    const float WORLD_HEIGHT = 600.0f;
+    const float PLAYER_SIZE = 40.0f;
+    const float GRAVITY = 1800.0f;
+    const float JUMP_VELOCITY = -480.0f;
+    const float SCROLL_SPEED = 180.0f;
+    const float START_X = 100.0f;
+    const float START_Y = 300.0f;
+
+    // map tile (x, y) covers [tileX(x), tileX(x) + TILE_SIZE) in world space
+    const float TILE_SIZE = 40.0f;
+    const float MAP_ORIGIN_X = 200.0f;
+    const float MAP_ORIGIN_Y = 100.0f;
+    inline float tileX(int x) { return x * TILE_SIZE + MAP_ORIGIN_X; }
+    inline float tileY(int y) { return y * TILE_SIZE + MAP_ORIGIN_Y; }
+
+    struct PlayerState {
+        float x = START_X;
+        float y = START_Y;
+        float velocity = 0.0f;
+        int score = 0;
+        bool dead = false;
+        bool finished = false;
+        bool ended() const { return dead || finished; }
+    };
+
+    // Coins one player picked up. The level only scrolls forward, so only
+    // the columns around the player are remembered, whatever the map length.
+    class CoinTracker {
+        public:
+            explicit CoinTracker(int height = 0);
+            // returns true the first time the coin at (x, y) is taken
+            bool take(int x, int y);
+        private:
+            static const int WINDOW_COLUMNS = 8;
+            int _height;
+            int _firstColumn;
+            std::vector<bool> _taken;
+    };
+
+    void stepPlayer(PlayerState& player, bool jetpack, float dt);
+    // picks up coins and applies zapper / finish hits for the tiles under the player
+    void collide(const MapFormat::PackedMap& map, PlayerState& player, CoinTracker& coins);
+};
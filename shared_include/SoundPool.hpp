@@ -0,0 +1,137 @@
+#pragma once
+
+#include <SFML/Audio.hpp>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// A fixed set of sf::Sound voices shared by every effect, so the number of
+// audio sources is bounded. Binding a voice to a buffer allocates inside
+// SFML, so a free voice already bound to the sound is preferred and the
+// binding is kept: replaying an effect does not allocate. Each category
+// has a voice limit and a priority:
+//  - a category at its limit reuses its own oldest voice,
+//  - otherwise a free voice is taken,
+//  - otherwise the oldest voice of the lowest priority category (not above
+//    the new sound's) is stolen, or the new sound is dropped.
+class SoundPool {
+public:
+    // identifies one playback, stale once its voice has been reused
+    struct Handle {
+        size_t voice = SIZE_MAX;
+        uint32_t generation = 0;
+    };
+
+    explicit SoundPool(size_t voiceCount) : voices(voiceCount), sequence(0) {}
+
+    // returns the category id to pass to play()
+    int addCategory(size_t maxVoices, int priority) {
+        categories.push_back({maxVoices, priority, 0});
+        return static_cast<int>(categories.size()) - 1;
+    }
+    // an invalid handle if every voice is busy with something more important
+    Handle play(const sf::SoundBuffer& buffer, int category, bool loop = false) {
+        Voice* voice = pickVoice(buffer, category);
+        if (!voice) {
+            return Handle();
+        }
+        release(*voice);
+        if (voice->sound.getBuffer() != &buffer) {
+            voice->sound.setBuffer(buffer);
+        }
+        voice->sound.setLoop(loop);
+        voice->sound.play();
+        voice->category = category;
+        voice->startedAt = ++sequence;
+        voice->generation++;
+        categories[category].playing++;
+        return {static_cast<size_t>(voice - voices.data()), voice->generation};
+    }
+    void stop(const Handle& handle) {
+        if (isPlaying(handle)) {
+            release(voices[handle.voice]);
+        }
+    }
+    bool isPlaying(const Handle& handle) const {
+        if (handle.voice >= voices.size()) {
+            return false;
+        }
+        const Voice& voice = voices[handle.voice];
+        return voice.generation == handle.generation && voice.category >= 0
+            && voice.sound.getStatus() != sf::Sound::Stopped;
+    }
+    void stopAll() {
+        for (auto& voice : voices) {
+            release(voice);
+        }
+    }
+    size_t getVoiceCount() const {
+        return voices.size();
+    }
+
+private:
+    struct Category {
+        size_t maxVoices;
+        int priority;
+        size_t playing;
+    };
+    struct Voice {
+        sf::Sound sound;
+        int category = -1;
+        uint64_t startedAt = 0;
+        uint32_t generation = 0;
+    };
+
+    // a finished one-shot still counts against its category until reclaimed here
+    bool isFree(Voice& voice) {
+        if (voice.category >= 0 && voice.sound.getStatus() == sf::Sound::Stopped) {
+            categories[voice.category].playing--;
+            voice.category = -1;
+        }
+        return voice.category < 0;
+    }
+    void release(Voice& voice) {
+        if (voice.category >= 0) {
+            voice.sound.stop();
+            categories[voice.category].playing--;
+            voice.category = -1;
+        }
+    }
+    // lower priority first, then the oldest
+    bool stealsBefore(const Voice& a, const Voice& b) const {
+        int priorityA = categories[a.category].priority;
+        int priorityB = categories[b.category].priority;
+        return priorityA != priorityB ? priorityA < priorityB : a.startedAt < b.startedAt;
+    }
+    Voice* pickVoice(const sf::SoundBuffer& buffer, int category) {
+        // reclaims the finished voices first so the counts below are current
+        Voice* free = nullptr;
+        for (auto& voice : voices) {
+            if (isFree(voice) && (!free || (free->sound.getBuffer() != &buffer && voice.sound.getBuffer() == &buffer))) {
+                free = &voice;
+            }
+        }
+        const Category& wanted = categories[category];
+        bool full = wanted.playing >= wanted.maxVoices;
+        if (!full && free) {
+            return free;
+        }
+        Voice* victim = nullptr;
+        for (auto& voice : voices) {
+            if (voice.category < 0) {
+                continue;
+            }
+            if (full ? voice.category != category : categories[voice.category].priority > wanted.priority) {
+                continue;
+            }
+            if (!victim || stealsBefore(voice, *victim)) {
+                victim = &voice;
+            }
+        }
+        return victim;
+    }
+
+    std::vector<Voice> voices;
+    std::vector<Category> categories;
+    uint64_t sequence;
+};
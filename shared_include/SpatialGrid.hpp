@@ -0,0 +1,114 @@
+#pragma once
+#include <deque>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// axis aligned box in world space, same edges as sf::FloatRect
+struct GridBox {
+    float left;
+    float top;
+    float width;
+    float height;
+    bool intersects(const GridBox& other) const {
+        return left < other.left + other.width && other.left < left + width
+            && top < other.top + other.height && other.top < top + height;
+    }
+};
+
+// Uniform grid over world space for the client collision checks, one cell
+// per map tile. An entity is stored once, in the cell holding its top left
+// corner; a query widens the box by the largest entity inserted so far and
+// only visits the cells under it, so its cost depends on what is around
+// the box, not on the level length. Columns are kept in a deque so the
+// ones that scrolled past can be dropped from the front.
+template <typename T>
+class SpatialGrid {
+    public:
+        using Box = GridBox;
+
+        SpatialGrid(float cellSize, float originX, float originY)
+            : _cellSize(cellSize), _originX(originX), _originY(originY),
+              _firstColumn(0), _maxWidth(0.0f), _maxHeight(0.0f), _size(0) {}
+
+        void insert(const Box& box, const T& value) {
+            int column = columnOf(box.left);
+            if (_columns.empty()) {
+                _firstColumn = column;
+            }
+            while (column < _firstColumn) {
+                _columns.emplace_front();
+                _firstColumn--;
+            }
+            if (column - _firstColumn >= static_cast<int>(_columns.size())) {
+                _columns.resize(column - _firstColumn + 1);
+            }
+            auto& rows = _columns[column - _firstColumn];
+            size_t row = static_cast<size_t>(std::max(0, rowOf(box.top)));
+            if (row >= rows.size()) {
+                rows.resize(row + 1);
+            }
+            rows[row].push_back(Entry{box, value});
+            _maxWidth = std::max(_maxWidth, box.width);
+            _maxHeight = std::max(_maxHeight, box.height);
+            _size++;
+        }
+
+        // calls visit(box, value) for every entity whose box intersects area
+        template <typename Visit>
+        void query(const Box& area, Visit visit) {
+            int first = std::max(columnOf(area.left - _maxWidth), _firstColumn);
+            int last = std::min(columnOf(area.left + area.width), _firstColumn + static_cast<int>(_columns.size()) - 1);
+            int top = std::max(0, rowOf(area.top - _maxHeight));
+            int bottom = std::max(0, rowOf(area.top + area.height));
+            for (int column = first; column <= last; ++column) {
+                auto& rows = _columns[column - _firstColumn];
+                int rowEnd = std::min(bottom, static_cast<int>(rows.size()) - 1);
+                for (int row = top; row <= rowEnd; ++row) {
+                    for (auto& entry : rows[row]) {
+                        if (entry.box.intersects(area)) {
+                            visit(entry.box, entry.value);
+                        }
+                    }
+                }
+            }
+        }
+
+        // forgets the entities of the columns that end at or before x
+        void dropBefore(float x) {
+            int column = columnOf(x);
+            while (!_columns.empty() && _firstColumn < column) {
+                for (const auto& row : _columns.front()) {
+                    _size -= row.size();
+                }
+                _columns.pop_front();
+                _firstColumn++;
+            }
+        }
+
+        void clear() {
+            _columns.clear();
+            _maxWidth = 0.0f;
+            _maxHeight = 0.0f;
+            _size = 0;
+        }
+
+        size_t size() const { return _size; }
+    private:
+        struct Entry {
+            Box box;
+            T value;
+        };
+
+        int columnOf(float x) const { return static_cast<int>(std::floor((x - _originX) / _cellSize)); }
+        int rowOf(float y) const { return static_cast<int>(std::floor((y - _originY) / _cellSize)); }
+
+        float _cellSize;
+        float _originX;
+        float _originY;
+        int _firstColumn;
+        float _maxWidth;
+        float _maxHeight;
+        size_t _size;
+        std::deque<std::vector<std::vector<Entry>>> _columns;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+
+// Quads sharing one texture (or untextured coloured quads), written into a
+// single vertex array so the whole batch is one draw call. A batch can be
+// refilled every frame or built once and kept, patching single quads
+// (animation frame, colour) through the index add() returned.
+class SpriteBatch {
+public:
+    explicit SpriteBatch(const sf::Texture* texture = nullptr) : texture(texture), vertices(sf::Triangles) {}
+    void setTexture(const sf::Texture* batchTexture) {
+        texture = batchTexture;
+    }
+    void clear() {
+        vertices.clear();
+    }
+    // the sprite's current animation frame, transform and colour; its texture must be the batch one
+    std::size_t add(const sf::Sprite& sprite) {
+        sf::IntRect frame = sprite.getTextureRect();
+        return addQuad(sprite.getTransform(), sf::Vector2f(frame.width, frame.height), frame, sprite.getColor());
+    }
+    // axis aligned quad showing frame of the batch texture
+    std::size_t add(const sf::Vector2f& position, const sf::Vector2f& size, const sf::IntRect& frame,
+                    const sf::Color& color = sf::Color::White) {
+        sf::Transform transform;
+        transform.translate(position);
+        return addQuad(transform, size, frame, color);
+    }
+    // untextured rectangle, for batches without texture
+    std::size_t add(const sf::Vector2f& position, const sf::Vector2f& size, const sf::Color& color) {
+        return add(position, size, sf::IntRect(), color);
+    }
+    void setTextureRect(std::size_t index, const sf::IntRect& frame) {
+        sf::Vector2f texCoords[4];
+        frameCorners(frame, texCoords);
+        for (int i = 0; i < 6; ++i) {
+            vertices[index * 6 + i].texCoords = texCoords[CORNERS[i]];
+        }
+    }
+    void setColor(std::size_t index, const sf::Color& color) {
+        for (int i = 0; i < 6; ++i) {
+            vertices[index * 6 + i].color = color;
+        }
+    }
+    std::size_t size() const {
+        return vertices.getVertexCount() / 6;
+    }
+    // returns the number of draw calls issued, 0 or 1
+    int draw(sf::RenderTarget& target) const {
+        if (vertices.getVertexCount() == 0) {
+            return 0;
+        }
+        target.draw(vertices, sf::RenderStates(texture));
+        return 1;
+    }
+
+private:
+    // each quad is two triangles over its corners 0-1-2 and 0-2-3
+    static constexpr int CORNERS[6] = {0, 1, 2, 0, 2, 3};
+
+    static void frameCorners(const sf::IntRect& frame, sf::Vector2f* corners) {
+        float left = static_cast<float>(frame.left);
+        float top = static_cast<float>(frame.top);
+        float right = left + frame.width;
+        float bottom = top + frame.height;
+        corners[0] = sf::Vector2f(left, top);
+        corners[1] = sf::Vector2f(right, top);
+        corners[2] = sf::Vector2f(right, bottom);
+        corners[3] = sf::Vector2f(left, bottom);
+    }
+
+    // corners in local space mapped through transform
+    std::size_t addQuad(const sf::Transform& transform, const sf::Vector2f& extent, const sf::IntRect& frame, const sf::Color& color) {
+        sf::Vector2f corners[4] = {
+            transform.transformPoint(sf::Vector2f(0, 0)),
+            transform.transformPoint(sf::Vector2f(extent.x, 0)),
+            transform.transformPoint(sf::Vector2f(extent.x, extent.y)),
+            transform.transformPoint(sf::Vector2f(0, extent.y))
+        };
+        sf::Vector2f texCoords[4];
+        frameCorners(frame, texCoords);
+        for (int corner : CORNERS) {
+            vertices.append(sf::Vertex(corners[corner], color, texCoords[corner]));
+        }
+        return size() - 1;
+    }
+
+    const sf::Texture* texture;
+    sf::VertexArray vertices;
+};
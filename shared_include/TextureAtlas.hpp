@@ -0,0 +1,122 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// Where a sheet ended up: the atlas page holding it and its rectangle there.
+struct AtlasRegion {
+    const sf::Texture* texture;
+    sf::IntRect rect;
+
+    // a rectangle given in sheet coordinates, in atlas coordinates
+    sf::IntRect map(const sf::IntRect& frame) const {
+        return sf::IntRect(rect.left + frame.left, rect.top + frame.top, frame.width, frame.height);
+    }
+    sf::Vector2u getSize() const {
+        return sf::Vector2u(rect.width, rect.height);
+    }
+};
+
+// Sprite sheets packed into as few textures as the GPU size limit allows,
+// so everything using them shares one texture and SFML skips the rebinds
+// between draws. Sheets are laid out on shelves, tallest first, then
+// uploaded one by one into their page.
+class TextureAtlas {
+public:
+    // gap between sheets, keeps filtering from blending neighbours
+    static const unsigned PADDING = 2;
+
+    // creates the pages; false if a sheet is larger than maxSize
+    bool layout(const std::vector<std::pair<std::string, sf::Vector2u>>& sheets, unsigned maxSize) {
+        clear();
+        unsigned widest = 0;
+        double area = 0;
+        for (const auto& sheet : sheets) {
+            if (sheet.second.x > maxSize || sheet.second.y > maxSize) {
+                return false;
+            }
+            widest = std::max(widest, sheet.second.x);
+            area += static_cast<double>(sheet.second.x + PADDING) * (sheet.second.y + PADDING);
+        }
+        unsigned width = 1;
+        while (width < std::max<double>(widest, std::sqrt(area)) && width < maxSize) {
+            width *= 2;
+        }
+        width = std::min(width, maxSize);
+
+        std::vector<size_t> order(sheets.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return sheets[a].second.y > sheets[b].second.y;
+        });
+        // page heights, x / y / shelf height of the shelf being filled
+        std::vector<unsigned> heights;
+        std::vector<size_t> pageOf(sheets.size());
+        std::vector<sf::IntRect> rects(sheets.size());
+        unsigned x = 0, y = 0, shelf = 0;
+        for (size_t index : order) {
+            sf::Vector2u size = sheets[index].second;
+            if (heights.empty() || x + size.x > width) {
+                y += shelf;
+                x = 0;
+                shelf = 0;
+            }
+            if (heights.empty() || y + size.y > maxSize) {
+                heights.push_back(0);
+                x = y = shelf = 0;
+            }
+            pageOf[index] = heights.size() - 1;
+            rects[index] = sf::IntRect(x, y, size.x, size.y);
+            heights.back() = std::max(heights.back(), y + size.y);
+            x += size.x + PADDING;
+            shelf = std::max(shelf, size.y + PADDING);
+        }
+        for (unsigned height : heights) {
+            pages.emplace_back();
+            if (!pages.back().create(width, std::max(height, 1u))) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < sheets.size(); ++i) {
+            regions[sheets[i].first] = {&pages[pageOf[i]], rects[i]};
+        }
+        return true;
+    }
+    // RGBA pixels of a sheet given to layout()
+    void upload(const std::string& name, const sf::Uint8* pixels) {
+        const AtlasRegion& region = regions.at(name);
+        for (auto& page : pages) {
+            if (&page == region.texture) {
+                page.update(pixels, region.rect.width, region.rect.height, region.rect.left, region.rect.top);
+            }
+        }
+    }
+    void clear() {
+        regions.clear();
+        pages.clear();
+    }
+    bool contains(const std::string& name) const {
+        return regions.find(name) != regions.end();
+    }
+    const AtlasRegion& getRegion(const std::string& name) const {
+        return regions.at(name);
+    }
+    size_t getPageCount() const {
+        return pages.size();
+    }
+    const sf::Texture& getPage(size_t index) const {
+        return pages[index];
+    }
+
+private:
+    // a deque keeps the page addresses the regions point to
+    std::deque<sf::Texture> pages;
+    std::map<std::string, AtlasRegion> regions;
+};
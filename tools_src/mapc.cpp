@@ -0,0 +1,35 @@
+#include "../shared_include/MapFormat.hpp"
+#include "../shared_include/Error.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+
+// Compiles an ASCII .map file into the binary format the server maps in place.
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <input.map> <output.jpm>" << std::endl;
+        return ERROR;
+    }
+    try {
+        GameMap map = GameMap::loadFromFile(argv[1]);
+        std::vector<uint8_t> packed = MapFormat::pack(map);
+        // written aside then renamed, a server may have the old file mapped
+        std::string tmp = std::string(argv[2]) + ".tmp";
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out.write(reinterpret_cast<const char*>(packed.data()), packed.size())) {
+            throw std::runtime_error("Failed to write " + tmp);
+        }
+        out.close();
+        if (std::rename(tmp.c_str(), argv[2]) != 0) {
+            throw std::runtime_error(std::string("Failed to replace ") + argv[2]);
+        }
+        std::cout << argv[1] << ": " << map.width << "x" << map.height << " -> "
+                  << argv[2] << " (" << packed.size() << " bytes)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return ERROR;
+    }
+    return SUCCESS;
+}
@@ -0,0 +1,86 @@
+#include "../shared_include/AssetManager.hpp"
+#include "../shared_include/AssetPack.hpp"
+#include "../shared_include/Error.hpp"
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <cstring>
+#include <cstdio>
+
+static std::vector<uint8_t> readFile(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// textures and sounds are stored decoded unless keepEncoded, fonts always as their file
+static std::vector<uint8_t> packAsset(const AssetManager::Source& source, bool keepEncoded, AssetPack::Entry& entry)
+{
+    entry = {source.name, source.kind, AssetPack::Encoding::FILE, 0, 0, 0, 0, nullptr, 0};
+    if (keepEncoded || source.kind == AssetPack::Kind::FONT) {
+        return readFile(source.filename);
+    }
+    if (source.kind == AssetPack::Kind::TEXTURE) {
+        sf::Image image;
+        if (!image.loadFromFile(source.filename)) {
+            throw std::runtime_error(std::string("Cannot decode ") + source.filename);
+        }
+        entry.encoding = AssetPack::Encoding::RGBA;
+        entry.width = image.getSize().x;
+        entry.height = image.getSize().y;
+        const uint8_t* pixels = image.getPixelsPtr();
+        return std::vector<uint8_t>(pixels, pixels + static_cast<size_t>(entry.width) * entry.height * 4);
+    }
+    sf::SoundBuffer sound;
+    if (!sound.loadFromFile(source.filename)) {
+        throw std::runtime_error(std::string("Cannot decode ") + source.filename);
+    }
+    entry.encoding = AssetPack::Encoding::PCM;
+    entry.channels = sound.getChannelCount();
+    entry.sampleRate = sound.getSampleRate();
+    std::vector<uint8_t> samples(sound.getSampleCount() * sizeof(sf::Int16));
+    if (!samples.empty()) {
+        std::memcpy(samples.data(), sound.getSamples(), samples.size());
+    }
+    return samples;
+}
+
+// Packs the client assets into one archive the client maps at startup.
+int main(int argc, char* argv[])
+{
+    bool keepEncoded = argc == 3 && std::string(argv[1]) == "--encoded";
+    if (argc != 2 && !keepEncoded) {
+        std::cerr << "Usage: " << argv[0] << " [--encoded] <output.pak>" << std::endl;
+        return ERROR;
+    }
+    const std::string output = argv[argc - 1];
+    try {
+        std::vector<AssetPack::Entry> entries;
+        std::vector<std::vector<uint8_t>> blobs;
+        for (const auto& source : AssetManager::defaultAssets()) {
+            entries.emplace_back();
+            blobs.push_back(packAsset(source, keepEncoded, entries.back()));
+            std::cout << source.filename << " -> " << source.name << " (" << blobs.back().size() << " bytes)" << std::endl;
+        }
+        std::vector<uint8_t> packed = AssetPack::build(entries, blobs);
+        // written aside then renamed, a running client may have the old file mapped
+        std::string tmp = output + ".tmp";
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out.write(reinterpret_cast<const char*>(packed.data()), packed.size())) {
+            throw std::runtime_error("Failed to write " + tmp);
+        }
+        out.close();
+        if (std::rename(tmp.c_str(), output.c_str()) != 0) {
+            throw std::runtime_error("Failed to replace " + output);
+        }
+        std::cout << output << ": " << entries.size() << " assets, " << packed.size() << " bytes" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return ERROR;
+    }
+    return SUCCESS;
+}